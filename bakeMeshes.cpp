@@ -0,0 +1,41 @@
+//
+// INCLUDES
+//
+
+//classes, none of which need a gl context
+#include "./classes/ObjLoader.hpp"
+#include "./classes/MeshCache.hpp"
+
+//c++ libraries
+#include <vector>
+#include <iostream>
+#include <string>
+
+//
+// MAIN
+//
+
+/*
+	Cook each .obj given on the command line into the .mvmesh next to it, which `ModelFactory::fromObj`
+	loads instead of parsing the .obj. Exits with 1 if any of them couldn't be baked.
+*/
+int main(int argc, char* argv[]) {
+	int failures = 0;
+
+	for (int i = 1; i < argc; i++) {
+		std::vector<float> vertices;
+		std::vector<uint32_t> indices;
+		ObjLoader loader;
+		std::string cacheName = std::string(argv[i]) + ".mvmesh";
+
+		if (!loader.load(argv[i], vertices, indices, true) || !MeshCache::write(cacheName.c_str(), argv[i], vertices, 8, indices)) {
+			std::cout << "Could not bake " << argv[i] << "!" << std::endl;
+			failures++;
+			continue;
+		}
+
+		std::cout << "Baked " << cacheName << " (" << vertices.size() / 8 << " vertices, " << indices.size() / 3 << " triangles)" << std::endl;
+	}
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,634 @@
+//
+// INCLUDES
+//
+
+//graphics libraries, only used for the drawing benchmarks
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+//helpers
+#include "./helpers/openGlHelpers.cpp"
+#include "./helpers/globals.h"
+#include "./helpers/allocationCounter.cpp"
+#ifdef HEADLESS
+#include "./helpers/headlessHelpers.cpp"
+#endif
+
+//classes
+#include "./classes/ObjLoader.hpp"
+#include "./classes/MeshCache.hpp"
+#include "./classes/Model.hpp"
+#include "./classes/ModelFactory.hpp"
+#include "./classes/Object.hpp"
+#include "./classes/Piano.hpp"
+#include "./classes/Lamp.hpp"
+#include "./classes/Ground.hpp"
+#include "./classes/Song.hpp"
+#include "./classes/TextureAtlas.hpp"
+#include "./classes/RenderQueue.hpp"
+#include "./classes/StaticBatch.hpp"
+#include "./classes/Shader.hpp"
+#include "./classes/ShaderLibrary.hpp"
+
+//c++ libraries
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+//
+// GLOBALS
+//
+
+//the same globals midiVis defines, the scene classes expect them
+SDL_Window* gWindow = nullptr;
+std::atomic<bool> gShouldExit(false);
+SDL_GLContext gCtx = nullptr;
+const unsigned short gNumTextures = 12;
+unsigned int gTextures[gNumTextures];
+Camera gCamera(0, 7, 10);
+ShaderLibrary gShaders;
+
+//
+// MEASUREMENT
+//
+
+//the timings of one benchmark, in milliseconds
+struct Result {
+	std::string name;
+	std::string input;
+	size_t noteCount = 0; //0 for benchmarks that aren't about a song
+	std::vector<double> samples;
+	long allocationCount = -1; //heap allocations made by the samples, -1 where they aren't counted
+};
+
+std::deque<Result> results; //a deque so references from `addResult()` stay good as it grows
+
+Result& addResult(const char* name, const std::string& input, size_t noteCount) {
+	results.emplace_back();
+	results.back().name = name;
+	results.back().input = input;
+	results.back().noteCount = noteCount;
+	return results.back();
+}
+
+/*
+	Run `function` once and return how long it took in milliseconds.
+*/
+template<typename Function>
+double timeMs(Function function) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	function();
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static double percentile(std::vector<double> values, double fraction) {
+	if (values.empty())
+		return 0.0;
+	size_t index = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+static void writeJsonString(std::ostream& out, const std::string& text) {
+	out << '"';
+	for (size_t i = 0; i < text.size(); i++) {
+		char c = text[i];
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if ((unsigned char)c < 0x20) {
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			out << escaped;
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+/*
+	Write every result with its minimum, percentiles, mean and maximum, one result per line so runs
+	diff cleanly.
+*/
+bool writeResults(const char* fileName, const std::string& renderer, int repeatCount, int frameCount) {
+	std::ofstream file(fileName);
+	if (!file.is_open()) {
+		std::cout << "Could not open " << fileName << " for writing." << std::endl;
+		return false;
+	}
+
+	file << "{" << std::endl;
+	file << "\"version\": 1," << std::endl;
+	file << "\"renderer\": ";
+	writeJsonString(file, renderer);
+	file << "," << std::endl;
+	file << "\"hardwareThreads\": " << std::thread::hardware_concurrency() << "," << std::endl;
+	file << "\"repeats\": " << repeatCount << "," << std::endl;
+	file << "\"frames\": " << frameCount << "," << std::endl;
+	file << "\"unit\": \"ms\"," << std::endl;
+	file << "\"results\": [";
+	char number[32];
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& result = results[i];
+		double sum = 0.0;
+		for (size_t j = 0; j < result.samples.size(); j++) {
+			sum += result.samples[j];
+		}
+		double mean = result.samples.empty() ? 0.0 : sum / result.samples.size();
+
+		file << (i == 0 ? "" : ",") << std::endl << "{\"name\": ";
+		writeJsonString(file, result.name);
+		file << ", \"input\": ";
+		writeJsonString(file, result.input);
+		file << ", \"notes\": " << result.noteCount << ", \"samples\": " << result.samples.size();
+		if (result.allocationCount >= 0) {
+			file << ", \"allocations\": " << result.allocationCount;
+		}
+		const std::pair<const char*, double> statistics[] = {
+			{"min", percentile(result.samples, 0.0)},
+			{"p50", percentile(result.samples, 0.5)},
+			{"p95", percentile(result.samples, 0.95)},
+			{"mean", mean},
+			{"max", percentile(result.samples, 1.0)}
+		};
+		for (const std::pair<const char*, double>& statistic : statistics) {
+			std::snprintf(number, sizeof(number), "%.6f", statistic.second);
+			file << ", \"" << statistic.first << "\": " << number;
+		}
+		file << "}";
+	}
+	file << std::endl << "]" << std::endl << "}" << std::endl;
+	return file.good();
+}
+
+//
+// SYNTHETIC SONGS
+//
+
+/*
+	Write a csv song of `noteCount` notes across the whole piano, eight to a beat with a mix of decimal
+	and fractional durations. The notes only depend on `noteCount`, so every run and every machine parses
+	the same file. Returns the song's length in beats.
+*/
+double writeSyntheticSong(const char* fileName, size_t noteCount, Piano& piano) {
+	static const char* durations[] = {"1/4", "49/100", "0.5", "1", "3/2", "2"};
+	const std::vector<std::string>& layout = piano.getLayout();
+	const double notesPerBeat = 8.0;
+
+	std::string text = ",note_name,start_time,duration,velocity,tempo\n";
+	text.reserve(noteCount * 32);
+	uint32_t random = 12345;
+	char line[96];
+	for (size_t i = 0; i < noteCount; i++) {
+		random = random * 1664525u + 1013904223u; //numerical recipes' lcg, the same everywhere
+		uint32_t bits = random >> 8;
+		int length = std::snprintf(line, sizeof(line), "%zu,%s,%.3f,%s,%u,124\n", i,
+			layout[bits % layout.size()].c_str(), i / notesPerBeat, durations[(bits / 128) % 6], 40 + (bits / 1024) % 88);
+		text.append(line, length);
+	}
+
+	std::ofstream file(fileName, std::ios::binary);
+	file.write(text.data(), text.size());
+	return noteCount / notesPerBeat + 2.0;
+}
+
+//
+// SCENE
+//
+
+//the scene as midiVis draws it, without the loading screen or the window
+struct Scene {
+	std::vector<Object*> objects;
+	Model* skyBox = nullptr;
+	StaticBatch staticBatch;
+	RenderQueue renderQueue;
+	float lightPosition[4] = {0.0f, 7.0f, 0.0f, 1.0f};
+	float lightAmbient[4] = {0.16f, 0.16f, 0.16f, 1.0f};
+	float lightDiffuse[4] = {0.9f, 0.9f, 0.9f, 1.0f};
+};
+
+/*
+	Read and upload the scene's textures, the small ones into the atlas. Each file's read is timed as
+	"bmp.map": the file is mapped and its header checked, the pixels are only touched by the upload.
+*/
+void loadTextures(int repeatCount) {
+	const std::vector<std::pair<gTextureHandles, const char*>> textureFiles = {
+		{gTextureHandles::TEST, "./res/img/test.bmp"},
+		{gTextureHandles::LAMP_POST, "./res/img/lampPost.bmp"},
+		{gTextureHandles::LAMP_SHADE, "./res/img/lampShade.bmp"},
+		{gTextureHandles::LAMP_LIGHT, "./res/img/lampLight.bmp"},
+		{gTextureHandles::PIANO_SHELL, "./res/img/pianoShell.bmp"},
+		{gTextureHandles::WHITE_KEY, "./res/img/whiteKey.bmp"},
+		{gTextureHandles::BLACK_KEY, "./res/img/blackKey.bmp"},
+		{gTextureHandles::SKYBOX_HOR, "./res/img/skyboxSideStars.bmp"},
+		{gTextureHandles::FLOOR, "./res/img/floor.bmp"},
+		{gTextureHandles::CEMENT, "./res/img/cementBrick.bmp"},
+		{gTextureHandles::NOTE, "./res/img/note.bmp"}
+	};
+
+	TextureAtlas atlas;
+	for (size_t i = 0; i < textureFiles.size(); i++) {
+		gTextureHandles handle = textureFiles[i].first;
+		const char* file = textureFiles[i].second;
+
+		BmpImage image;
+		Result& mapBmp = addResult("bmp.map", file, 0);
+		for (int j = 0; j < repeatCount; j++) {
+			image = BmpImage();
+			bool isRead = false;
+			mapBmp.samples.push_back(timeMs([&]() { isRead = readBmpFile(file, image); }));
+			if (!isRead)
+				exit(1);
+		}
+
+		if (!TextureAtlas::contains(handle)) {
+			gTextures[handle] = createTexture(image, file);
+		} else if (atlas.add(handle, image)) {
+			unsigned int texture = atlas.createTexture();
+			for (unsigned int atlasHandle = 0; atlasHandle < gNumTextures; atlasHandle++) {
+				if (TextureAtlas::contains(atlasHandle)) {
+					gTextures[atlasHandle] = texture;
+				}
+			}
+		}
+	}
+}
+
+/*
+	Build the piano, lamp, ground and skybox and merge them the way `loadScene()` does.
+*/
+void buildScene(Scene& scene, Piano* piano) {
+	piano->pos[2] = 1.0f;
+	Lamp* lamp = new Lamp();
+	lamp->pos[0] = 6.5f;
+	lamp->pos[2] = 2.5f;
+	scene.lightPosition[0] = lamp->pos[0];
+	scene.lightPosition[2] = lamp->pos[2];
+	scene.objects = {piano, lamp, new Ground()};
+
+	scene.skyBox = ModelFactory::fromSkybox();
+	scene.skyBox->setTextureHandle(gTextureHandles::SKYBOX_HOR);
+	scene.skyBox->upload();
+
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		scene.objects[i]->addStatic(scene.staticBatch);
+	}
+	scene.staticBatch.build();
+	scene.staticBatch.upload();
+}
+
+void destroyScene(Scene& scene) {
+	delete scene.skyBox;
+	scene.staticBatch.clear();
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		delete scene.objects[i];
+	}
+	scene.objects.clear();
+}
+
+/*
+	Draw a frame of the scene and `song` with the shaders, the same steps as midiVis's `draw()`.
+*/
+void drawScene(Scene& scene, Song& song) {
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	scene.skyBox->pos[0] = gCamera.getPosX();
+	scene.skyBox->pos[1] = gCamera.getPosY();
+	scene.skyBox->pos[2] = gCamera.getPosZ();
+
+	scene.renderQueue.clear();
+	scene.staticBatch.submit(scene.renderQueue);
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		scene.objects[i]->submit(scene.renderQueue);
+	}
+
+	float view[16];
+	float projection[16];
+	gCamera.getViewMatrix(view);
+	gCamera.getProjectionMatrix(projection);
+	gShaders.setCamera(view, projection, scene.skyBox->pos);
+	gShaders.setLight(scene.lightPosition, scene.lightAmbient, scene.lightDiffuse);
+
+	Shader* sceneShader = gShaders.get("scene");
+	sceneShader->use();
+	sceneShader->setUniform("isLit", 0);
+	sceneShader->setUniform("isTextured", 1);
+	glDisable(GL_DEPTH_TEST);
+	scene.skyBox->draw();
+	glEnable(GL_DEPTH_TEST);
+
+	scene.renderQueue.draw();
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		scene.objects[i]->draw();
+	}
+	song.draw();
+}
+
+//
+// BENCHMARKS
+//
+
+/*
+	Time parsing `csvFile`, and loading the song cache made from it. Leaves the cache next to the csv.
+*/
+void benchmarkSongLoad(const std::string& name, const char* csvFile, Piano& piano, int repeatCount) {
+	size_t noteCount = 0;
+	Result& parse = addResult("csv.parse", name, 0);
+	for (int i = 0; i < repeatCount; i++) {
+		Song song;
+		parse.samples.push_back(timeMs([&]() { song.addNotesFromCsv(csvFile, &piano); }));
+		noteCount = song.getNoteCount();
+	}
+	parse.noteCount = noteCount;
+
+	//loading through `addNotesFromFile` writes the cache when it's missing or stale
+	{
+		Song song;
+		song.addNotesFromFile(csvFile, &piano);
+	}
+	std::string cacheFile = std::string(csvFile) + ".mvsong";
+	Result& cache = addResult("mvsong.load", name, noteCount);
+	for (int i = 0; i < repeatCount; i++) {
+		Song song;
+		cache.samples.push_back(timeMs([&]() { song.addNotesFromFile(cacheFile.c_str(), &piano); }));
+	}
+}
+
+/*
+	Time `frameCount` frames of `Song::update()` from `startBeat`, and when there's a gl context
+	`Song::draw()`'s submission and whole frames of the scene. Each frame is finished before the next
+	so submission times don't include waiting on earlier frames.
+*/
+void benchmarkSongFrames(const std::string& name, const char* songFile, double startBeat, Piano& piano, Scene* scene, int frameCount) {
+	Song song;
+	song.addNotesFromFile(songFile, &piano);
+	size_t noteCount = song.getNoteCount();
+	const double deltaTime = 1000.0 / 60.0;
+
+	//the frame path shouldn't allocate once it's warmed up, the samples are reserved so they don't either
+	Result& update = addResult("song.update", name, noteCount);
+	update.samples.reserve(frameCount);
+	song.seek(startBeat);
+	size_t allocationCount = getAllocationCount();
+	for (int i = 0; i < frameCount; i++) {
+		update.samples.push_back(timeMs([&]() { song.update(deltaTime); }));
+	}
+	update.allocationCount = getAllocationCount() - allocationCount;
+	if (scene == nullptr)
+		return;
+
+	//the notes go to the gpu once, that's not part of a frame
+	Result& upload = addResult("song.upload", name, noteCount);
+	upload.samples.push_back(timeMs([&]() { song.upload(); glFinish(); }));
+
+	Result& draw = addResult("song.draw", name, noteCount);
+	draw.samples.reserve(frameCount);
+	song.seek(startBeat);
+	song.draw(); //the first draw builds the note program, and the driver compiles its state
+	glFinish();
+	allocationCount = getAllocationCount();
+	for (int i = 0; i < frameCount; i++) {
+		song.update(deltaTime);
+		draw.samples.push_back(timeMs([&]() { song.draw(); }));
+		glFinish();
+	}
+	draw.allocationCount = getAllocationCount() - allocationCount;
+
+	//one frame first to warm up too, the render queue grows to fit the scene on the first
+	auto drawFrame = [&]() {
+		song.update(deltaTime);
+		for (size_t i = 0; i < scene->objects.size(); i++) {
+			scene->objects[i]->update(deltaTime, song.getKeyStates());
+		}
+		drawScene(*scene, song);
+		glFinish();
+	};
+	Result& frame = addResult("frame", name, noteCount);
+	frame.samples.reserve(frameCount);
+	song.seek(startBeat);
+	drawFrame();
+	allocationCount = getAllocationCount();
+	for (int i = 0; i < frameCount; i++) {
+		frame.samples.push_back(timeMs(drawFrame));
+	}
+	frame.allocationCount = getAllocationCount() - allocationCount;
+}
+
+//
+//	OPTIONS
+//
+
+//what was asked for on the command line
+struct Options {
+	const char* outputFile = "./benchmark.json";
+	int repeatCount = 5;
+	int frameCount = 600;
+	size_t maxNoteCount = 1000000;
+	bool isCheckingAllocations = false; //fail if a warmed up frame allocates
+	unsigned short width = 1024;
+	unsigned short height = 768;
+};
+
+void printUsage(const char* program) {
+	std::cout << "Usage: " << program << " [options]" << std::endl
+		<< "  --output FILE    where to write the results as json, ./benchmark.json by default" << std::endl
+		<< "  --repeats N      times to repeat each load, 5 by default" << std::endl
+		<< "  --frames N       frames to time per song, 600 by default" << std::endl
+		<< "  --max-notes N    largest synthetic song, from 1000 up to 1000000 notes by default" << std::endl
+		<< "  --size WxH       size of the offscreen framebuffer, 1024x768 by default" << std::endl
+		<< "  --check-allocations" << std::endl
+		<< "                   exit with 1 if the frame path allocates once it's warmed up, the driver's" << std::endl
+		<< "                   allocations count too" << std::endl;
+}
+
+/*
+	Read the command line into `options`, returns false if it can't be understood.
+*/
+bool parseOptions(int argc, char* argv[], Options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* argument = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		char* end = nullptr;
+		if (std::strcmp(argument, "--check-allocations") == 0) {
+			options.isCheckingAllocations = true;
+			continue;
+		}
+		if (value == nullptr)
+			return false;
+
+		if (std::strcmp(argument, "--output") == 0) {
+			options.outputFile = value;
+		} else if (std::strcmp(argument, "--repeats") == 0) {
+			long repeatCount = std::strtol(value, &end, 10);
+			if (*end != '\0' || repeatCount < 1 || repeatCount > 1000)
+				return false;
+			options.repeatCount = (int)repeatCount;
+		} else if (std::strcmp(argument, "--frames") == 0) {
+			long frameCount = std::strtol(value, &end, 10);
+			if (*end != '\0' || frameCount < 1 || frameCount > 1000000)
+				return false;
+			options.frameCount = (int)frameCount;
+		} else if (std::strcmp(argument, "--max-notes") == 0) {
+			long long maxNoteCount = std::strtoll(value, &end, 10);
+			if (*end != '\0' || maxNoteCount < 1)
+				return false;
+			options.maxNoteCount = (size_t)maxNoteCount;
+		} else if (std::strcmp(argument, "--size") == 0) {
+			long width = std::strtol(value, &end, 10);
+			if (*end != 'x')
+				return false;
+			long height = std::strtol(end + 1, &end, 10);
+			if (*end != '\0' || width < 1 || height < 1 || width > 16384 || height > 16384)
+				return false;
+			options.width = (unsigned short)width;
+			options.height = (unsigned short)height;
+		} else {
+			return false;
+		}
+		i++;
+	}
+	return true;
+}
+
+//
+// MAIN
+//
+
+/*
+	Time the load paths and the frame path over the bundled song and mesh and over synthetic songs of
+	1k to 1M notes, and write the results as json. Drawing is only timed in builds with a headless
+	context. Run from the repository root, where ./res is.
+*/
+int main(int argc, char* argv[]) {
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	//a gl context without a window, the drawing benchmarks are skipped without one
+	std::string renderer = "none";
+#ifdef HEADLESS
+	if (createHeadlessContext(options.width, options.height, true) && gShaders.init()) {
+		renderer = (const char*)glGetString(GL_RENDERER);
+		setProjection((float)options.width / options.height);
+	} else {
+		std::cout << "Drawing won't be timed without a shader capable context." << std::endl;
+	}
+#endif
+	bool canDraw = gShaders.isReady();
+	gShouldExit = false;
+
+	//meshes
+	std::cout << "Timing mesh loads..." << std::endl;
+	const char* objFile = "./res/obj/pianoShell.obj";
+	Result& parseObj = addResult("obj.parse", objFile, 0);
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	for (int i = 0; i < options.repeatCount; i++) {
+		ObjLoader loader;
+		parseObj.samples.push_back(timeMs([&]() { loader.load(objFile, vertices, indices, true); }));
+	}
+
+	//the cache isn't shipped, so it's baked from the parsed mesh first, the way bakeMeshes does
+	std::string meshCacheFile = std::string(objFile) + ".mvmesh";
+	if (vertices.empty() || !MeshCache::write(meshCacheFile.c_str(), objFile, vertices, 8, indices)) {
+		std::cout << "Could not write " << meshCacheFile << ", its load won't be timed." << std::endl;
+	} else {
+		Result& loadMesh = addResult("mvmesh.load", meshCacheFile, 0);
+		for (int i = 0; i < options.repeatCount; i++) {
+			MeshCache cache;
+			bool isLoaded = false;
+			loadMesh.samples.push_back(timeMs([&]() { isLoaded = cache.load(meshCacheFile.c_str(), objFile, 8); }));
+			if (!isLoaded) {
+				std::cout << "Could not load " << meshCacheFile << ", its load won't be timed." << std::endl;
+				results.pop_back();
+				break;
+			}
+		}
+	}
+
+	//textures, they're uploaded for the frames when there's a context
+	std::cout << "Timing texture loads..." << std::endl;
+	if (canDraw) {
+		loadTextures(options.repeatCount);
+	} else {
+		for (const char* file : {"./res/img/pianoShell.bmp", "./res/img/skyboxSideStars.bmp", "./res/img/floor.bmp"}) {
+			Result& mapBmp = addResult("bmp.map", file, 0);
+			for (int i = 0; i < options.repeatCount; i++) {
+				BmpImage image;
+				bool isRead = false;
+				mapBmp.samples.push_back(timeMs([&]() { isRead = readBmpFile(file, image); }));
+				if (!isRead)
+					exit(1);
+			}
+		}
+	}
+
+	Piano* piano = new Piano();
+	Scene scene;
+	if (canDraw) {
+		buildScene(scene, piano);
+	}
+
+	//the bundled song, from the start
+	std::cout << "Timing skyReprise.csv..." << std::endl;
+	const char* bundledSong = "./res/song/skyReprise.csv";
+	benchmarkSongLoad("skyReprise.csv", bundledSong, *piano, options.repeatCount);
+	benchmarkSongFrames("skyReprise.csv", bundledSong, 0.0, *piano, canDraw ? &scene : nullptr, options.frameCount);
+
+	//synthetic songs, played from the middle so the window is as full as it gets
+	std::error_code error;
+	std::filesystem::path directory = std::filesystem::temp_directory_path(error) / "midiVisBenchmark";
+	std::filesystem::create_directories(directory, error);
+	for (size_t noteCount = 1000; noteCount <= options.maxNoteCount && !gShouldExit; noteCount *= 10) {
+		std::string name = "synthetic" + std::to_string(noteCount) + ".csv";
+		std::string songFile = (directory / name).string();
+		std::cout << "Timing " << name << "..." << std::endl;
+
+		double songLength = writeSyntheticSong(songFile.c_str(), noteCount, *piano);
+		benchmarkSongLoad(name, songFile.c_str(), *piano, options.repeatCount);
+		benchmarkSongFrames(name, songFile.c_str(), songLength / 2.0, *piano, canDraw ? &scene : nullptr, options.frameCount);
+	}
+	std::filesystem::remove_all(directory, error);
+
+	bool isWritten = writeResults(options.outputFile, renderer, options.repeatCount, options.frameCount);
+	if (isWritten) {
+		std::cout << "Wrote " << results.size() << " results to " << options.outputFile << "." << std::endl;
+	}
+
+	//allocating in the frame path is a regression, it shows up as jitter in long runs. Drivers may
+	//allocate the first time they see some state, so it's only an error when asked
+	bool isAllocationFree = true;
+	for (size_t i = 0; i < results.size(); i++) {
+		if (results[i].allocationCount > 0) {
+			std::cout << results[i].name << " on " << results[i].input << " allocated " << results[i].allocationCount << " times." << std::endl;
+			isAllocationFree = false;
+		}
+	}
+
+	//cleanup, the scene owns the piano once it's built
+	if (canDraw) {
+		destroyScene(scene);
+	} else {
+		delete piano;
+	}
+	gShaders.clear();
+#ifdef HEADLESS
+	cleanupHeadless();
+#endif
+	return isWritten && (isAllocationFree || !options.isCheckingAllocations) && !gShouldExit ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#ifndef ACTIVE_NOTES_HPP
+#define ACTIVE_NOTES_HPP
+
+#include "./NoteRenderer.hpp"
+#include "./KeyStates.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    The notes sounding at the playhead, kept up to date as it crosses their starts and ends rather than
+    by checking every note each frame. Moving forward only touches the notes that start and the ones
+    already sounding. Moving backwards finds the sounding notes again among those that started within
+    the longest note's duration. The keys they hold down are written to a `KeyStates`, a key takes its
+    velocity from the latest note on it.
+*/
+class ActiveNotes {
+    using Note = NoteRenderer::Note;
+
+    private:
+        const Note* _notes = nullptr; //sorted by start time, owned by the song
+        size_t _noteCount = 0;
+        double _maxDuration = 0.0;
+        double _time = 0.0;
+        size_t _nextStart = 0; //the first note that hasn't started by `_time`
+        std::vector<uint32_t> _sounding; //notes sounding at `_time`, in start order
+
+        static bool isSounding(const Note& note, double time) {
+            return note.startTime <= time && time < (double)note.startTime + note.duration;
+        }
+
+        /*
+            The most notes sounding at once, found by walking the starts against the sorted ends.
+        */
+        static size_t getMaxOverlap(const Note* notes, size_t noteCount) {
+            std::vector<double> endTimes(noteCount);
+            for (size_t i = 0; i < noteCount; i++) {
+                endTimes[i] = (double)notes[i].startTime + notes[i].duration;
+            }
+            std::sort(endTimes.begin(), endTimes.end());
+
+            size_t maxOverlap = 0;
+            size_t endedCount = 0;
+            for (size_t i = 0; i < noteCount; i++) {
+                while (endedCount < noteCount && endTimes[endedCount] <= notes[i].startTime) {
+                    endedCount++;
+                }
+                maxOverlap = std::max(maxOverlap, i + 1 - std::min(endedCount, i + 1));
+            }
+            return maxOverlap;
+        }
+
+        void writeKeys(KeyStates& keyStates) {
+            keyStates.clear();
+            for (size_t i = 0; i < _sounding.size(); i++) {
+                const Note& note = _notes[_sounding[i]];
+                keyStates.press(note.keyIndex, note.velocity, note.startTime);
+            }
+        }
+
+    public:
+        ActiveNotes() {
+            _sounding.reserve(KeyStates::MAX_KEY_COUNT);
+        }
+
+        /*
+            Track `notes`, which have to stay put until the next call. Call `seek()` before moving. Room
+            is made for as many notes as ever overlap, so moving never allocates.
+        */
+        void setNotes(const Note* notes, size_t noteCount, double maxDuration) {
+            _notes = notes;
+            _noteCount = noteCount;
+            _maxDuration = maxDuration;
+            _nextStart = 0;
+            _sounding.clear();
+            _sounding.reserve(getMaxOverlap(notes, noteCount));
+        }
+
+        /*
+            Find the notes sounding at `time` from scratch, with a binary search for the notes that can be.
+        */
+        void seek(double time, KeyStates& keyStates) {
+            auto startsBefore = [](const Note& note, double time) {
+                return note.startTime < time;
+            };
+            auto startsAfter = [](double time, const Note& note) {
+                return time < note.startTime;
+            };
+            const Note* end = _notes + _noteCount;
+            size_t first = std::lower_bound(_notes, end, time - _maxDuration, startsBefore) - _notes;
+            _nextStart = std::upper_bound(_notes, end, time, startsAfter) - _notes;
+            _time = time;
+
+            _sounding.clear();
+            for (size_t i = first; i < _nextStart; i++) {
+                if (isSounding(_notes[i], time)) {
+                    _sounding.push_back((uint32_t)i);
+                }
+            }
+            writeKeys(keyStates);
+        }
+
+        /*
+            Move the playhead to `time`, `keyStates` is only written when a note starts or ends.
+        */
+        void moveTo(double time, KeyStates& keyStates) {
+            if (time < _time) {
+                seek(time, keyStates);
+                return;
+            }
+
+            //drop the notes that have ended, keeping the rest in order
+            size_t keptCount = 0;
+            for (size_t i = 0; i < _sounding.size(); i++) {
+                if (isSounding(_notes[_sounding[i]], time)) {
+                    _sounding[keptCount++] = _sounding[i];
+                }
+            }
+            bool hasChanged = keptCount != _sounding.size();
+            _sounding.resize(keptCount);
+
+            //notes that both start and end in this step are never seen
+            for (; _nextStart < _noteCount && _notes[_nextStart].startTime <= time; _nextStart++) {
+                if (isSounding(_notes[_nextStart], time)) {
+                    _sounding.push_back((uint32_t)_nextStart);
+                    hasChanged = true;
+                }
+            }
+
+            _time = time;
+            if (hasChanged) {
+                writeKeys(keyStates);
+            }
+        }
+
+        size_t getSoundingCount() {
+            return _sounding.size();
+        }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef ASSET_LOADER_HPP
+#define ASSET_LOADER_HPP
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+/*
+    Runs loading jobs on a pool of worker threads. Jobs do the file reading and decoding, anything that
+    needs the gl context is handed back with `addUpload()` and run on the main thread by
+    `processUploads()`, which also reports progress.
+*/
+class AssetLoader {
+    private:
+        std::vector<std::thread> _workers;
+        std::deque<std::function<void()>> _jobs;
+        std::deque<std::function<void()>> _uploads;
+        std::mutex _mutex;
+        std::condition_variable _jobAdded;
+        std::condition_variable _uploadAdded;
+        bool _isStopping = false;
+
+        //every job and upload counts as a task, jobs may add more tasks while they run
+        size_t _taskCount = 0;
+        size_t _finishedCount = 0;
+
+        std::function<void(size_t, size_t)> _progressCallback;
+        size_t _reportedCount = (size_t)-1;
+
+        void runWorker() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true) {
+                _jobAdded.wait(lock, [this] { return _isStopping || !_jobs.empty(); });
+                if (_isStopping)
+                    return;
+
+                std::function<void()> job = std::move(_jobs.front());
+                _jobs.pop_front();
+                lock.unlock();
+                job();
+                lock.lock();
+                _finishedCount++;
+                _uploadAdded.notify_one(); //wake the main thread so it can report progress
+            }
+        }
+
+    public:
+        /*
+            Start `workerCount` workers, or one per hardware thread if it's 0.
+        */
+        AssetLoader(size_t workerCount = 0) {
+            if (workerCount == 0) {
+                workerCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+            for (size_t i = 0; i < workerCount; i++) {
+                _workers.emplace_back(&AssetLoader::runWorker, this);
+            }
+        }
+
+        /*
+            Stops the workers, jobs that haven't started yet are dropped.
+        */
+        ~AssetLoader() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _isStopping = true;
+            }
+            _jobAdded.notify_all();
+            for (size_t i = 0; i < _workers.size(); i++) {
+                _workers.at(i).join();
+            }
+        }
+
+        AssetLoader(const AssetLoader&) = delete;
+        AssetLoader& operator=(const AssetLoader&) = delete;
+
+        /*
+            Queue `job` for a worker thread, it must not touch the gl context.
+        */
+        void addJob(std::function<void()> job) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _jobs.push_back(std::move(job));
+                _taskCount++;
+            }
+            _jobAdded.notify_one();
+        }
+
+        /*
+            Queue `upload` for the main thread, safe to call from a job.
+        */
+        void addUpload(std::function<void()> upload) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _uploads.push_back(std::move(upload));
+                _taskCount++;
+            }
+            _uploadAdded.notify_one();
+        }
+
+        /*
+            Called with the number of finished tasks and the total known so far whenever it changes.
+        */
+        void setProgressCallback(std::function<void(size_t, size_t)> progressCallback) {
+            _progressCallback = std::move(progressCallback);
+        }
+
+        /*
+            Main thread only. Waits up to `timeoutMs` for something to happen, then runs the queued
+            uploads and reports progress. Returns true once every task has finished.
+        */
+        bool processUploads(int timeoutMs) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _uploadAdded.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+                return !_uploads.empty() || _finishedCount == _taskCount || _finishedCount != _reportedCount;
+            });
+
+            while (!_uploads.empty()) {
+                std::function<void()> upload = std::move(_uploads.front());
+                _uploads.pop_front();
+                lock.unlock();
+                upload();
+                lock.lock();
+                _finishedCount++;
+            }
+
+            size_t finishedCount = _finishedCount;
+            size_t taskCount = _taskCount;
+            lock.unlock();
+
+            if (finishedCount != _reportedCount) {
+                _reportedCount = finishedCount;
+                if (_progressCallback) {
+                    _progressCallback(finishedCount, taskCount);
+                }
+            }
+            return finishedCount == taskCount;
+        }
+};
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef AUDIO_PLAYER_HPP
+#define AUDIO_PLAYER_HPP
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_mixer.h"
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/*
+    Plays the song's audio through SDL_mixer, either a rendered track or the notes synthesized as they
+    go, and keeps the master clock: where the device is in the audio, counted in samples as each buffer
+    is mixed. The visuals follow it with `followClock()`, so they can't drift away from what's heard.
+*/
+class AudioPlayer {
+    public:
+        //a note for the synthesizer, in seconds
+        struct Tone {
+            double startTime;
+            double endTime;
+            float frequency;
+            float amplitude;
+        };
+
+    private:
+        struct Voice {
+            double phase;
+            double phaseStep;
+            double endTime;
+            float amplitude;
+            float gain;
+            bool isAttacking;
+            bool isActive;
+        };
+
+        static const int _bufferFrames = 1024;
+        static const size_t _voiceCount = 64;
+
+        bool _isOpen = false;
+        bool _isPlaying = false;
+        int _frequency = 0;
+        int _channels = 0;
+        Mix_Music* _music = nullptr;
+
+        //the synthesizer, only touched by the audio thread once it's started
+        std::vector<Tone> _tones;
+        size_t _nextTone = 0;
+        Voice _voices[_voiceCount] = {};
+        uint64_t _synthFrames = 0;
+        float _attackStep = 0.0f; //gain added per frame until a voice is at full volume
+        float _decay = 0.0f; //gain kept per frame while a tone is held
+        float _release = 0.0f; //and once it's let go
+
+        //how many frames have been mixed and when the last buffer was, written by the audio thread and read
+        //by the main thread. The version is odd while they're being written, so a read that saw an odd or
+        //changed version tries again
+        std::atomic<uint32_t> _clockVersion{0};
+        std::atomic<uint64_t> _mixedFrames{0};
+        std::atomic<int64_t> _mixedAt{0}; //steady clock nanoseconds
+
+        //how far the visuals had drifted from the audio clock, measured every frame before correcting
+        const double _maxDrift = 0.1; //seconds, past which the visuals jump instead of catching up
+        const double _driftCorrection = 0.1; //how much of the drift is taken out each frame
+        double _totalDrift = 0.0;
+        double _largestDrift = 0.0;
+        size_t _driftCount = 0;
+        size_t _jumpCount = 0;
+
+        static void countMixedFrames(void* player, Uint8* stream, int length) {
+            AudioPlayer* self = (AudioPlayer*)player;
+            int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            uint64_t frames = length / (self->_channels * (int)sizeof(Sint16));
+
+            uint32_t version = self->_clockVersion.load(std::memory_order_relaxed);
+            self->_clockVersion.store(version + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            self->_mixedFrames.store(self->_mixedFrames.load(std::memory_order_relaxed) + frames, std::memory_order_relaxed);
+            self->_mixedAt.store(now, std::memory_order_relaxed);
+            self->_clockVersion.store(version + 2, std::memory_order_release);
+        }
+
+        static void fillMusic(void* player, Uint8* stream, int length) {
+            ((AudioPlayer*)player)->synthesize((Sint16*)stream, length / (((AudioPlayer*)player)->_channels * (int)sizeof(Sint16)));
+        }
+
+        void startVoice(const Tone& tone) {
+            //with every voice busy, the quietest is cut off
+            size_t chosen = 0;
+            for (size_t i = 0; i < _voiceCount; i++) {
+                if (!_voices[i].isActive) {
+                    chosen = i;
+                    break;
+                }
+                if (_voices[i].gain < _voices[chosen].gain) {
+                    chosen = i;
+                }
+            }
+
+            Voice& voice = _voices[chosen];
+            voice.phase = 0.0;
+            voice.phaseStep = 2.0 * M_PI * tone.frequency / _frequency;
+            voice.endTime = tone.endTime;
+            voice.amplitude = tone.amplitude;
+            voice.gain = 0.0f;
+            voice.isAttacking = true;
+            voice.isActive = true;
+        }
+
+        /*
+            Fill `frameCount` frames with the tones that are sounding, a sine and its octave per tone
+            under a short attack and an exponential decay.
+        */
+        void synthesize(Sint16* samples, int frameCount) {
+            for (int i = 0; i < frameCount; i++) {
+                double time = (double)(_synthFrames + i) / _frequency;
+                while (_nextTone < _tones.size() && _tones[_nextTone].startTime <= time) {
+                    startVoice(_tones[_nextTone]);
+                    _nextTone++;
+                }
+
+                float value = 0.0f;
+                for (size_t j = 0; j < _voiceCount; j++) {
+                    Voice& voice = _voices[j];
+                    if (!voice.isActive)
+                        continue;
+
+                    if (time >= voice.endTime) {
+                        voice.gain *= _release;
+                        if (voice.gain < 0.0005f) {
+                            voice.isActive = false;
+                            continue;
+                        }
+                    } else if (voice.isAttacking) {
+                        voice.gain = std::min(voice.amplitude, voice.gain + _attackStep * voice.amplitude);
+                        voice.isAttacking = voice.gain < voice.amplitude;
+                    } else {
+                        voice.gain *= _decay;
+                    }
+
+                    value += voice.gain * (float)(std::sin(voice.phase) + 0.3 * std::sin(2.0 * voice.phase));
+                    voice.phase += voice.phaseStep;
+                }
+
+                Sint16 sample = (Sint16)(std::max(-1.0f, std::min(1.0f, value * 0.15f)) * 32767.0f);
+                for (int channel = 0; channel < _channels; channel++) {
+                    samples[i * _channels + channel] = sample;
+                }
+            }
+            _synthFrames += frameCount;
+        }
+
+    public:
+        AudioPlayer() {}
+
+        ~AudioPlayer() {
+            close();
+        }
+
+        AudioPlayer(const AudioPlayer&) = delete;
+        AudioPlayer& operator=(const AudioPlayer&) = delete;
+
+        /*
+            Open the default audio device, or the driver named by SDL_AUDIODRIVER ("dummy" needs no sound
+            card and still plays in real time). Returns false if there's no device.
+        */
+        bool open() {
+            if (_isOpen)
+                return true;
+            if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+                std::cout << "Failed to initalize SDL audio: " << SDL_GetError() << std::endl;
+                return false;
+            }
+            if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, AUDIO_S16SYS, 2, _bufferFrames) < 0) {
+                std::cout << "Failed to open the audio device: " << Mix_GetError() << std::endl;
+                SDL_QuitSubSystem(SDL_INIT_AUDIO);
+                return false;
+            }
+
+            Uint16 format;
+            Mix_QuerySpec(&_frequency, &format, &_channels);
+            _attackStep = 1.0f / (0.005f * _frequency);
+            _decay = (float)std::exp(-1.5 / _frequency);
+            _release = (float)std::exp(-25.0 / _frequency);
+            _isOpen = true;
+            std::cout << "Opened audio through the " << SDL_GetCurrentAudioDriver() << " driver at " << _frequency << "Hz." << std::endl;
+            return true;
+        }
+
+        /*
+            Load a rendered track, wav, ogg or whatever else SDL_mixer was built with, for `play()`.
+        */
+        bool loadTrack(const char* fileName) {
+            if (!_isOpen)
+                return false;
+            _music = Mix_LoadMUS(fileName);
+            if (_music == nullptr) {
+                std::cout << "Could not load " << fileName << ": " << Mix_GetError() << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        /*
+            Synthesize `tones` for `play()` instead of playing a track.
+        */
+        void setTones(std::vector<Tone> tones) {
+            std::sort(tones.begin(), tones.end(), [](const Tone& a, const Tone& b) {
+                return a.startTime < b.startTime;
+            });
+            _tones = std::move(tones);
+            _nextTone = 0;
+            _synthFrames = 0;
+        }
+
+        /*
+            Start the audio and the clock from zero.
+        */
+        void play() {
+            if (!_isOpen || _isPlaying)
+                return;
+            Mix_SetPostMix(countMixedFrames, this);
+            if (_music != nullptr) {
+                Mix_PlayMusic(_music, 0);
+            } else {
+                Mix_HookMusic(fillMusic, this);
+            }
+            _isPlaying = true;
+        }
+
+        bool isOpen() {
+            return _isOpen;
+        }
+
+        bool isPlaying() {
+            return _isPlaying;
+        }
+
+        /*
+            Where the device is in the audio, in seconds. The buffer mixed last is the one being played,
+            so its frames are counted as time passes rather than all at once.
+        */
+        double getTime() {
+            uint32_t version;
+            uint64_t frames;
+            int64_t mixedAt;
+            do {
+                version = _clockVersion.load(std::memory_order_acquire);
+                frames = _mixedFrames.load(std::memory_order_relaxed);
+                mixedAt = _mixedAt.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+            } while ((version & 1) != 0 || version != _clockVersion.load(std::memory_order_relaxed));
+
+            if (frames == 0)
+                return 0.0;
+            int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            double bufferTime = (double)_bufferFrames / _frequency;
+            double sinceMixed = std::max(0.0, std::min(bufferTime, (now - mixedAt) / 1e9));
+            return std::max(0.0, (double)frames / _frequency - bufferTime + sinceMixed);
+        }
+
+        /*
+            How far to move the visuals this frame, in milliseconds: `deltaTime` nudged towards the audio
+            clock from `visualTime`, in seconds. Small drift is taken out over a few frames so motion
+            stays smooth, anything larger is jumped. The visuals wait for the device to start.
+        */
+        double followClock(double deltaTime, double visualTime) {
+            if (!_isPlaying)
+                return deltaTime;
+            double audioTime = getTime();
+            if (audioTime == 0.0)
+                return 0.0;
+
+            double drift = audioTime - (visualTime + deltaTime / 1000.0);
+            _totalDrift += std::abs(drift);
+            _largestDrift = std::max(_largestDrift, std::abs(drift));
+            _driftCount++;
+
+            if (std::abs(drift) > _maxDrift) {
+                _jumpCount++;
+                return (audioTime - visualTime) * 1000.0;
+            }
+            return std::max(0.0, deltaTime + drift * _driftCorrection * 1000.0);
+        }
+
+        /*
+            Print how far the visuals drifted from the audio before being corrected.
+        */
+        void printDrift(std::ostream& out) {
+            if (_driftCount == 0)
+                return;
+            out << "Audio drift: " << (_totalDrift / _driftCount * 1000.0) << "ms on average, " << (_largestDrift * 1000.0)
+                << "ms at most, " << _jumpCount << " jumps over " << _driftCount << " frames." << std::endl;
+        }
+
+        /*
+            Stop the audio and close the device.
+        */
+        void close() {
+            if (!_isOpen)
+                return;
+            if (_isPlaying) {
+                Mix_HaltMusic();
+                Mix_HookMusic(nullptr, nullptr);
+                Mix_SetPostMix(nullptr, nullptr);
+                _isPlaying = false;
+            }
+            if (_music != nullptr) {
+                Mix_FreeMusic(_music);
+                _music = nullptr;
+            }
+            Mix_CloseAudio();
+            SDL_QuitSubSystem(SDL_INIT_AUDIO);
+            _isOpen = false;
+        }
+};
+
+#endif
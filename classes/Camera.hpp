@@ -4,7 +4,11 @@
 #include <GL/glew.h>
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_opengl.h"
+
+#include "../helpers/matrixHelpers.cpp"
+
 #include <cmath>
+#include <algorithm>
 
 class Camera {
     private:
@@ -13,6 +17,10 @@ class Camera {
         double _r;
         double _yMin = 0.1;
         double _yMax = 25;
+        float _aspectRatio = 4.0f / 3.0f;
+        const float _fieldOfView = 60.0f;
+        const float _near = 0.1f;
+        const float _far = 100.0f;
 
     public:
         Camera(double theta, double y, double r) {
@@ -28,14 +36,28 @@ class Camera {
             _y = std::min(_y, _yMax);
         }
 
+        void setAspectRatio(float aspectRatio) {
+            _aspectRatio = aspectRatio;
+        }
+
+        void getViewMatrix(float m[16]) {
+            const float eye[3] = {getPosX(), getPosY(), getPosZ()};
+            const float center[3] = {0.0f, (float)(_y * 0.1) + 2.0f, 0.0f};
+            const float up[3] = {0.0f, 1.0f, 0.0f};
+            lookAtMatrix(eye, center, up, m);
+        }
+
+        void getProjectionMatrix(float m[16]) {
+            perspectiveMatrix(_fieldOfView, _aspectRatio, _near, _far, m);
+        }
+
+        /*
+            Apply the view to the fixed function modelview matrix, for drivers without shaders.
+        */
         void setModelViewMatrix() {
-            double x = sin(_theta) * _r;
-            double z = cos(_theta) * _r;
-            gluLookAt(
-                x, _y, z,
-                0, (_y * 0.1) + 2, 0,
-                0, 1, 0
-            );
+            float view[16];
+            getViewMatrix(view);
+            glMultMatrixf(view);
         }
 
         float getPosX() {
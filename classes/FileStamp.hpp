@@ -0,0 +1,69 @@
+#ifndef FILE_STAMP_HPP
+#define FILE_STAMP_HPP
+
+#include "./MappedFile.hpp"
+
+#include <filesystem>
+#include <cstdint>
+
+/*
+    Identifies the version of a source file a cache was built from. It's stored as is in cache headers,
+    so its layout is part of their formats.
+*/
+struct FileStamp {
+    uint64_t size;
+    int64_t modifiedTime;
+    uint64_t hash;
+
+    static bool isLittleEndian() {
+        const uint16_t one = 1;
+        return *(const unsigned char*)&one == 1;
+    }
+
+    //64 bit FNV-1a
+    static uint64_t hashBytes(const char* data, size_t size) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static int64_t getModifiedTime(const char* fileName) {
+        std::error_code error;
+        return (int64_t)std::filesystem::last_write_time(fileName, error).time_since_epoch().count();
+    }
+
+    /*
+        Stamp `fileName` as it is now, returns false if it can't be read.
+    */
+    static bool fromFile(const char* fileName, FileStamp& stamp) {
+        MappedFile file(fileName);
+        if (!file.isOpen())
+            return false;
+
+        stamp.size = file.size();
+        stamp.modifiedTime = getModifiedTime(fileName);
+        stamp.hash = hashBytes(file.data(), file.size());
+        return true;
+    }
+
+    /*
+        `fileName` still matches if it has the same size and either the same modified time or, if it
+        was only touched, the same contents.
+    */
+    bool matches(const char* fileName) const {
+        std::error_code error;
+        uint64_t fileSize = std::filesystem::file_size(fileName, error);
+        if (error || fileSize != size)
+            return false;
+        if (getModifiedTime(fileName) == modifiedTime)
+            return true;
+
+        MappedFile file(fileName);
+        return file.isOpen() && hashBytes(file.data(), file.size()) == hash;
+    }
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef KEY_STATES_HPP
+#define KEY_STATES_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+/*
+    What each of the piano's keys is doing this frame. `Song` fills it in every update and the scene's
+    objects read it through a const reference, it's a fixed size so neither side ever allocates.
+*/
+class KeyStates {
+    public:
+        static const size_t MAX_KEY_COUNT = 128; //one per midi note
+
+    private:
+        std::bitset<MAX_KEY_COUNT> _activeKeys;
+        int _velocities[MAX_KEY_COUNT] = {};
+        double _onsetTimes[MAX_KEY_COUNT] = {}; //in beats, when the note holding the key down started
+        size_t _keyCount = 0;
+        uint32_t _version = 0;
+
+    public:
+        void setKeyCount(size_t keyCount) {
+            _keyCount = keyCount < MAX_KEY_COUNT ? keyCount : MAX_KEY_COUNT;
+            clear();
+        }
+
+        size_t size() const {
+            return _keyCount;
+        }
+
+        /*
+            Release every key.
+        */
+        void clear() {
+            _activeKeys.reset();
+            _version++;
+        }
+
+        /*
+            Hold `keyIndex` down for a note, keys outside the piano are ignored.
+        */
+        void press(int keyIndex, int velocity, double onsetTime) {
+            if (keyIndex < 0 || (size_t)keyIndex >= _keyCount)
+                return;
+            _activeKeys.set(keyIndex);
+            _velocities[keyIndex] = velocity;
+            _onsetTimes[keyIndex] = onsetTime;
+            _version++;
+        }
+
+        /*
+            Let go of `keyIndex`.
+        */
+        void release(int keyIndex) {
+            if (keyIndex < 0 || (size_t)keyIndex >= _keyCount || !_activeKeys.test(keyIndex))
+                return;
+            _activeKeys.reset(keyIndex);
+            _version++;
+        }
+
+        bool isActive(size_t keyIndex) const {
+            return keyIndex < _keyCount && _activeKeys.test(keyIndex);
+        }
+
+        //a bit per key, set while it's held down
+        const std::bitset<MAX_KEY_COUNT>& getActiveKeys() const {
+            return _activeKeys;
+        }
+
+        //how hard the key was struck, only meaningful while it's active
+        int getVelocity(size_t keyIndex) const {
+            return _velocities[keyIndex];
+        }
+
+        double getOnsetTime(size_t keyIndex) const {
+            return _onsetTimes[keyIndex];
+        }
+
+        //changes whenever any key does, so readers can skip work when nothing has
+        uint32_t getVersion() const {
+            return _version;
+        }
+};
+
+#endif
@@ -33,19 +33,31 @@ class Lamp : public Object {
             _fullBrightModels.push_back(lampLight);
         }
 
-        void draw() override {
-            // Draw the lamp shade and lightbulb at full brightness
-            glDisable(GL_LIGHTING);
-            glPushMatrix();
-            glTranslatef(pos[0], pos[1], pos[2]);
+        void upload() override {
             for (size_t i = 0; i < _fullBrightModels.size(); i++) {
-                _fullBrightModels.at(i)->draw();
+                _fullBrightModels.at(i)->upload();
+            }
+            Object::upload();
+        }
+
+        void addStatic(StaticBatch& batch) override {
+            for (size_t i = 0; i < _fullBrightModels.size(); i++) {
+                batch.add(_fullBrightModels.at(i), pos, false);
+            }
+            Object::addStatic(batch);
+        }
+
+        void submit(RenderQueue& queue) override {
+            if (_isBatched)
+                return;
+
+            //the lamp shade and lightbulb are drawn at full brightness
+            for (size_t i = 0; i < _fullBrightModels.size(); i++) {
+                queue.submit(_fullBrightModels.at(i), pos, false);
             }
-            glPopMatrix();
-            glEnable(GL_LIGHTING);
 
-            // Draw the rest of the models under the infuence of the light
-            Object::draw();
+            //the rest of the models are under the influence of the light
+            Object::submit(queue);
         }
 };
 
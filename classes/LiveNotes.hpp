@@ -0,0 +1,200 @@
+#ifndef LIVE_NOTES_HPP
+#define LIVE_NOTES_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include "./Piano.hpp"
+#include "./NoteRenderer.hpp"
+#include "./KeyStates.hpp"
+#include "./MidiInput.hpp"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+/*
+    Notes played live, taken from a `MidiInput` every update. While a key is held its note grows up out
+    of it, once it's let go the note floats away upwards at the speed a song's notes fall. Everything is
+    sized up front so taking input never allocates.
+*/
+class LiveNotes {
+    using Note = NoteRenderer::Note;
+    using KeyPlacement = NoteRenderer::KeyPlacement;
+
+    struct LiveNote {
+        double startTime; //in beats, like a song's notes
+        double endTime; //negative while the key is still held
+        int keyIndex;
+        int velocity;
+    };
+
+    private:
+        static const size_t _maxNoteCount = 1024;
+
+        std::vector<LiveNote> _notes;
+        std::vector<Note> _instances; //`_notes` as the renderer draws them, rewritten every frame
+        std::vector<KeyPlacement> _keys;
+        NoteRenderer* _noteRenderer = nullptr;
+        Piano* _piano = nullptr;
+        KeyStates _keyStates;
+        double _time = 0.0;
+        bool _isInputFinished = false;
+        double _beatsPerMinute = 124.0; //the speed songs play at when they don't say
+        const double _lookAhead = 20.0 - 3.18; //how far above the keys a note is still in view
+
+        //how long events waited between the input thread reading them and the main thread taking them
+        size_t _eventCount = 0;
+        double _totalLatency = 0.0;
+        double _maxLatency = 0.0;
+
+        /*
+            Find the note still held on `keyIndex`, nullptr if there isn't one.
+        */
+        LiveNote* findHeldNote(int keyIndex) {
+            for (size_t i = _notes.size(); i > 0; i--) {
+                if (_notes[i - 1].keyIndex == keyIndex && _notes[i - 1].endTime < 0.0)
+                    return &_notes[i - 1];
+            }
+            return nullptr;
+        }
+
+        void handleEvent(const MidiInput::Event& event, std::chrono::steady_clock::time_point now) {
+            double latency = std::chrono::duration<double, std::milli>(now - event.time).count();
+            _eventCount++;
+            _totalLatency += latency;
+            _maxLatency = std::max(_maxLatency, latency);
+
+            int keyIndex = _piano->getKeyIndex(event.note);
+            if (keyIndex < 0)
+                return;
+
+            //place the event when it was read rather than when this frame took it
+            double time = _time - (latency / 1000.0) * (_beatsPerMinute / 60.0);
+            LiveNote* heldNote = findHeldNote(keyIndex);
+            if (heldNote != nullptr) {
+                heldNote->endTime = std::max(time, heldNote->startTime);
+            }
+
+            if (event.isNoteOn) {
+                //with every note still in view, the oldest makes room
+                if (_notes.size() == _maxNoteCount) {
+                    _notes.erase(_notes.begin());
+                }
+                _notes.push_back({time, -1.0, keyIndex, event.velocity});
+                _keyStates.press(keyIndex, event.velocity, time);
+            } else {
+                _keyStates.release(keyIndex);
+            }
+        }
+
+    public:
+        LiveNotes() {
+            _notes.reserve(_maxNoteCount);
+            _instances.reserve(_maxNoteCount);
+        }
+
+        ~LiveNotes() {
+            delete _noteRenderer;
+        }
+
+        LiveNotes(const LiveNotes&) = delete;
+        LiveNotes& operator=(const LiveNotes&) = delete;
+
+        /*
+            Play on `piano`'s keys, which have to stay around as long as this does.
+        */
+        void setPiano(Piano* piano) {
+            _piano = piano;
+            _keys = NoteRenderer::placeKeys(piano);
+            _keyStates.setKeyCount(_keys.size());
+            _notes.clear();
+            _isInputFinished = false;
+        }
+
+        /*
+            Take every event `input` has queued, then let go of the notes that have floated out of view.
+            Once the input has ended the keys still held are let go too, so everything floats away.
+        */
+        void update(double deltaTime, MidiInput& input) {
+            _time += (deltaTime / 1000.0) * (_beatsPerMinute / 60.0);
+            if (_piano == nullptr)
+                return;
+
+            //checked before taking the events, so every event queued before the end is taken with them
+            bool isInputFinished = input.isFinished();
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            MidiInput::Event event;
+            while (input.poll(event)) {
+                handleEvent(event, now);
+            }
+            if (isInputFinished && !_isInputFinished) {
+                for (size_t i = 0; i < _notes.size(); i++) {
+                    if (_notes[i].endTime < 0.0) {
+                        _notes[i].endTime = _time;
+                        _keyStates.release(_notes[i].keyIndex);
+                    }
+                }
+                _isInputFinished = true;
+            }
+
+            //notes are in the order they started, so the ones that are gone are near the front
+            _notes.erase(std::remove_if(_notes.begin(), _notes.end(), [this](const LiveNote& note) {
+                return note.endTime >= 0.0 && _time - note.endTime > _lookAhead;
+            }), _notes.end());
+        }
+
+        /*
+            Draw the notes, needs the gl context. A falling note's bottom is at its start time, so a
+            rising one is mirrored about the current time: held notes stay on the keys and glow while
+            they do, released ones move off them.
+        */
+        void draw() {
+            if (_piano == nullptr)
+                return;
+            if (_noteRenderer == nullptr) {
+                _noteRenderer = new NoteRenderer();
+                _noteRenderer->setKeys(_keys);
+            }
+
+            _instances.clear();
+            for (size_t i = 0; i < _notes.size(); i++) {
+                const LiveNote& liveNote = _notes[i];
+                double endTime = liveNote.endTime < 0.0 ? _time : liveNote.endTime;
+                Note note;
+                note.startTime = (float)(2.0 * _time - endTime);
+                note.duration = (float)(endTime - liveNote.startTime);
+                note.keyIndex = liveNote.keyIndex;
+                note.velocity = liveNote.velocity;
+                NoteRenderer::colorNote(note, _keys);
+                _instances.push_back(note);
+            }
+
+            _noteRenderer->setNotes(_instances.data(), _instances.size(), true);
+            _noteRenderer->draw(_time, 0, _instances.size(), _keyStates);
+        }
+
+        //whether the input has ended and every note it played has floated out of view
+        bool isFinished() const {
+            return _isInputFinished && _notes.empty();
+        }
+
+        const KeyStates& getKeyStates() const {
+            return _keyStates;
+        }
+
+        /*
+            Print how long input waited to be taken by the main thread, on top of which comes the rest of
+            the frame and the swap.
+        */
+        void printLatency(std::ostream& out) {
+            if (_eventCount == 0)
+                return;
+            out << "Took " << _eventCount << " midi events " << (_totalLatency / _eventCount) << "ms after they arrived on average, "
+                << _maxLatency << "ms at most." << std::endl;
+        }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <cstddef>
+
+/*
+    A read-only view of a whole file, memory mapped so it can be parsed in place without copying it
+    into a buffer first.
+*/
+class MappedFile {
+    private:
+        const char* _data = nullptr;
+        size_t _size = 0;
+        bool _isOpen = false;
+
+#ifdef _WIN32
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+#endif
+
+    public:
+        MappedFile(const char* fileName) {
+#ifdef _WIN32
+            _file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (_file == INVALID_HANDLE_VALUE)
+                return;
+
+            LARGE_INTEGER size;
+            GetFileSizeEx(_file, &size);
+            _size = (size_t)size.QuadPart;
+            _isOpen = true;
+            if (_size == 0)
+                return;
+
+            _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (_mapping != nullptr) {
+                _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+            }
+            if (_data == nullptr) {
+                _isOpen = false;
+            }
+#else
+            int fd = open(fileName, O_RDONLY);
+            if (fd < 0)
+                return;
+
+            struct stat info;
+            if (fstat(fd, &info) == 0) {
+                _size = (size_t)info.st_size;
+                _isOpen = true;
+                if (_size > 0) {
+                    void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (data == MAP_FAILED) {
+                        _isOpen = false;
+                    } else {
+                        _data = (const char*)data;
+                        madvise(data, _size, MADV_SEQUENTIAL);
+                    }
+                }
+            }
+            close(fd); //the mapping keeps the file alive
+#endif
+        }
+
+        ~MappedFile() {
+#ifdef _WIN32
+            if (_data != nullptr) UnmapViewOfFile(_data);
+            if (_mapping != nullptr) CloseHandle(_mapping);
+            if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+#else
+            if (_data != nullptr) munmap((void*)_data, _size);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool isOpen() {
+            return _isOpen;
+        }
+
+        const char* data() {
+            return _data;
+        }
+
+        size_t size() {
+            return _size;
+        }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include "./MappedFile.hpp"
+#include "./FileStamp.hpp"
+
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+
+/*
+    A cooked mesh (.mvmesh) kept next to the .obj it came from: a header, the interleaved vertices and
+    then the indices, all little endian. Loading one maps the file, the vertices and indices are read
+    straight out of the mapping.
+*/
+class MeshCache {
+    public:
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t vertexStride; //floats per vertex
+            uint32_t reserved;
+            uint64_t vertexCount;
+            uint64_t indexCount; //0 when the vertices are a plain triangle list
+            FileStamp source; //all zero when the mesh wasn't baked from a file
+            float boundsMin[3];
+            float boundsMax[3];
+        };
+
+    private:
+        static const uint32_t _version = 1;
+
+        MappedFile* _file = nullptr;
+        Header _header = {};
+
+    public:
+        MeshCache() = default;
+        MeshCache(const MeshCache&) = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+
+        ~MeshCache() {
+            delete _file;
+        }
+
+        /*
+            Grow `boundsMin` and `boundsMax` around the positions at the start of every vertex.
+        */
+        static void computeBounds(const std::vector<float>& vertices, size_t stride, float boundsMin[3], float boundsMax[3]) {
+            for (int axis = 0; axis < 3; axis++) {
+                boundsMin[axis] = vertices.empty() ? 0.0f : FLT_MAX;
+                boundsMax[axis] = vertices.empty() ? 0.0f : -FLT_MAX;
+            }
+            for (size_t i = 0; i + stride <= vertices.size(); i += stride) {
+                for (int axis = 0; axis < 3; axis++) {
+                    boundsMin[axis] = std::min(boundsMin[axis], vertices[i + axis]);
+                    boundsMax[axis] = std::max(boundsMax[axis], vertices[i + axis]);
+                }
+            }
+        }
+
+        /*
+            Map `cacheName`, returns false if it isn't a mesh cache with `vertexStride` floats per vertex.
+            If `sourceName` is given the cache is only used while it still matches that file.
+        */
+        bool load(const char* cacheName, const char* sourceName, uint32_t vertexStride) {
+            delete _file;
+            _file = nullptr;
+            if (!FileStamp::isLittleEndian())
+                return false;
+
+            MappedFile* file = new MappedFile(cacheName);
+            bool isValid = file->isOpen() && file->size() >= sizeof(Header);
+            if (isValid) {
+                std::memcpy(&_header, file->data(), sizeof(Header));
+                isValid = std::memcmp(_header.magic, "MVMC", 4) == 0
+                    && _header.version == _version
+                    && _header.vertexStride == vertexStride
+                    && _header.vertexCount < (file->size() / sizeof(float))
+                    && _header.indexCount < (file->size() / sizeof(uint32_t))
+                    && file->size() == sizeof(Header) + _header.vertexCount * vertexStride * sizeof(float) + _header.indexCount * sizeof(uint32_t);
+            }
+            if (isValid && sourceName != nullptr) {
+                isValid = _header.source.matches(sourceName);
+            }
+            if (!isValid) {
+                delete file;
+                return false;
+            }
+
+            _file = file;
+            return true;
+        }
+
+        /*
+            Write a mesh cache, stamped with `sourceName` if it's given. The cache is written to a
+            temporary file first so a reader never sees half of one.
+        */
+        static bool write(const char* cacheName, const char* sourceName, const std::vector<float>& vertices, uint32_t vertexStride, const std::vector<uint32_t>& indices) {
+            Header header = {};
+            if (!FileStamp::isLittleEndian())
+                return false;
+            if (sourceName != nullptr && !FileStamp::fromFile(sourceName, header.source))
+                return false;
+
+            std::memcpy(header.magic, "MVMC", 4);
+            header.version = _version;
+            header.vertexStride = vertexStride;
+            header.vertexCount = vertices.size() / vertexStride;
+            header.indexCount = indices.size();
+            computeBounds(vertices, vertexStride, header.boundsMin, header.boundsMax);
+
+            std::string temporaryName = std::string(cacheName) + ".tmp";
+            std::ofstream file(temporaryName, std::ios::binary);
+            file.write((const char*)&header, sizeof(Header));
+            file.write((const char*)vertices.data(), header.vertexCount * vertexStride * sizeof(float));
+            file.write((const char*)indices.data(), indices.size() * sizeof(uint32_t));
+            file.close();
+
+            std::error_code error;
+            if (!file.good()) {
+                std::filesystem::remove(temporaryName, error);
+                return false;
+            }
+            std::filesystem::rename(temporaryName, cacheName, error);
+            return !error;
+        }
+
+        const Header& getHeader() {
+            return _header;
+        }
+
+        const float* getVertices() {
+            return (const float*)(_file->data() + sizeof(Header));
+        }
+
+        const uint32_t* getIndices() {
+            return (const uint32_t*)(_file->data() + sizeof(Header) + _header.vertexCount * _header.vertexStride * sizeof(float));
+        }
+};
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef MESH_INDEXER_HPP
+#define MESH_INDEXER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+/*
+    Turns a triangle soup of interleaved vertices into a list of unique vertices and an index buffer,
+    optionally reordering the triangles so the gpu's post transform vertex cache gets reused.
+*/
+class MeshIndexer {
+    private:
+        static const int _cacheSize = 32; //modelled cache, larger than most real ones which still works out well
+
+        static uint32_t hashVertex(const float* vertex, size_t stride) {
+            //fnv-1a over the raw bits, identical vertices always have identical bits
+            uint32_t hash = 2166136261u;
+            const unsigned char* bytes = (const unsigned char*)vertex;
+            for (size_t i = 0; i < stride * sizeof(float); i++) {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+            return hash;
+        }
+
+        static float scoreVertex(int cachePosition, int activeTriangles) {
+            if (activeTriangles == 0)
+                return -1.0f;
+
+            float score = 0.0f;
+            if (cachePosition >= 3) {
+                float fromEnd = 1.0f - (float)(cachePosition - 3) / (_cacheSize - 3);
+                score = std::pow(fromEnd, 1.5f);
+            } else if (cachePosition >= 0) {
+                score = 0.75f; //the last triangle's vertices are scored flat so it isn't simply repeated
+            }
+
+            //favour vertices with few triangles left so they get finished off and leave the cache
+            return score + 2.0f / std::sqrt((float)activeTriangles);
+        }
+
+    public:
+        /*
+            Collapse the repeated vertices of `soup` (triangles, `stride` floats per vertex) into `vertices`
+            and `indices`.
+        */
+        static void index(const std::vector<float>& soup, size_t stride, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+            size_t cornerCount = soup.size() / stride;
+            vertices.clear();
+            indices.clear();
+            indices.reserve(cornerCount);
+
+            //open addressed table of vertex number + 1, at most half full
+            size_t tableSize = 16;
+            while (tableSize < cornerCount * 2) {
+                tableSize *= 2;
+            }
+            std::vector<uint32_t> table(tableSize, 0);
+
+            for (size_t corner = 0; corner < cornerCount; corner++) {
+                const float* vertex = &soup[corner * stride];
+                size_t slot = hashVertex(vertex, stride) & (tableSize - 1);
+                while (table[slot] != 0 && std::memcmp(&vertices[(table[slot] - 1) * stride], vertex, stride * sizeof(float)) != 0) {
+                    slot = (slot + 1) & (tableSize - 1);
+                }
+
+                if (table[slot] == 0) {
+                    vertices.insert(vertices.end(), vertex, vertex + stride);
+                    table[slot] = (uint32_t)(vertices.size() / stride);
+                }
+                indices.push_back(table[slot] - 1);
+            }
+        }
+
+        /*
+            Reorder the triangles in `indices` for the post transform vertex cache (Tom Forsyth's linear
+            speed greedy method), then renumber `vertices` in the order they're first used so fetches
+            walk through memory.
+        */
+        static void optimizeVertexCache(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices) {
+            size_t vertexCount = vertices.size() / stride;
+            size_t triangleCount = indices.size() / 3;
+            if (triangleCount == 0)
+                return;
+
+            //which triangles use each vertex, packed into one array
+            std::vector<int> activeTriangles(vertexCount, 0);
+            for (uint32_t index : indices) {
+                activeTriangles[index]++;
+            }
+            std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+            for (size_t v = 0; v < vertexCount; v++) {
+                adjacencyStart[v + 1] = adjacencyStart[v] + activeTriangles[v];
+            }
+            std::vector<uint32_t> adjacency(indices.size());
+            std::vector<size_t> adjacencyFill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+            for (size_t t = 0; t < triangleCount; t++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    adjacency[adjacencyFill[indices[t * 3 + corner]]++] = (uint32_t)t;
+                }
+            }
+
+            std::vector<int> cachePosition(vertexCount, -1);
+            std::vector<float> vertexScore(vertexCount);
+            for (size_t v = 0; v < vertexCount; v++) {
+                vertexScore[v] = scoreVertex(-1, activeTriangles[v]);
+            }
+
+            std::vector<float> triangleScore(triangleCount);
+            std::vector<bool> isEmitted(triangleCount, false);
+            for (size_t t = 0; t < triangleCount; t++) {
+                triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+            }
+
+            std::vector<uint32_t> ordered;
+            ordered.reserve(indices.size());
+            std::vector<uint32_t> cache;
+            std::vector<uint32_t> nextCache;
+            cache.reserve(_cacheSize + 3);
+            nextCache.reserve(_cacheSize + 3);
+
+            size_t scanCursor = 0;
+            long bestTriangle = -1;
+            for (size_t emitted = 0; emitted < triangleCount; emitted++) {
+                if (bestTriangle < 0) {
+                    //nothing in the cache touches a waiting triangle, start again from the first one left
+                    while (isEmitted[scanCursor]) {
+                        scanCursor++;
+                    }
+                    bestTriangle = (long)scanCursor;
+                }
+
+                isEmitted[bestTriangle] = true;
+                const uint32_t* triangle = &indices[bestTriangle * 3];
+                nextCache.assign(triangle, triangle + 3);
+                for (int corner = 0; corner < 3; corner++) {
+                    uint32_t v = triangle[corner];
+                    ordered.push_back(v);
+
+                    //retire the triangle from the vertex's active list
+                    uint32_t* begin = &adjacency[adjacencyStart[v]];
+                    uint32_t* end = begin + activeTriangles[v];
+                    for (uint32_t* t = begin; t < end; t++) {
+                        if (*t == (uint32_t)bestTriangle) {
+                            *t = *(end - 1);
+                            break;
+                        }
+                    }
+                    activeTriangles[v]--;
+                }
+
+                //the new triangle goes to the front of the cache, everything else shifts back
+                for (uint32_t v : cache) {
+                    if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                        nextCache.push_back(v);
+                    }
+                }
+                cache.swap(nextCache);
+
+                for (size_t position = 0; position < cache.size(); position++) {
+                    uint32_t v = cache[position];
+                    cachePosition[v] = position < (size_t)_cacheSize ? (int)position : -1;
+                    vertexScore[v] = scoreVertex(cachePosition[v], activeTriangles[v]);
+                }
+
+                //rescore the triangles around the cached vertices and pick the best for next time
+                bestTriangle = -1;
+                float bestScore = -1.0f;
+                for (uint32_t v : cache) {
+                    for (int i = 0; i < activeTriangles[v]; i++) {
+                        uint32_t t = adjacency[adjacencyStart[v] + i];
+                        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                        if (triangleScore[t] > bestScore) {
+                            bestScore = triangleScore[t];
+                            bestTriangle = (long)t;
+                        }
+                    }
+                }
+
+                if (cache.size() > (size_t)_cacheSize) {
+                    cache.resize(_cacheSize);
+                }
+            }
+
+            //renumber the vertices in the order the triangles now reach them
+            std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+            std::vector<float> reordered;
+            reordered.reserve(vertices.size());
+            for (uint32_t& index : ordered) {
+                if (remap[index] == UINT32_MAX) {
+                    remap[index] = (uint32_t)(reordered.size() / stride);
+                    reordered.insert(reordered.end(), &vertices[index * stride], &vertices[index * stride] + stride);
+                }
+                index = remap[index];
+            }
+
+            vertices.swap(reordered);
+            indices.swap(ordered);
+        }
+};
+
+#endif
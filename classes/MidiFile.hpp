@@ -0,0 +1,226 @@
+#ifndef MIDI_FILE_HPP
+#define MIDI_FILE_HPP
+
+#include "./MappedFile.hpp"
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+/*
+    Reads the notes and tempo changes out of a standard midi file (type 0 or 1). Times are reported in
+    beats (quarter notes), the same unit the csv songs use.
+*/
+class MidiFile {
+    public:
+        struct Note {
+            int key; //midi note number
+            int velocity;
+            double startTime;
+            double duration;
+        };
+
+        struct TempoChange {
+            double startTime;
+            double beatsPerMinute;
+        };
+
+    private:
+        struct OpenNote {
+            uint32_t startTick;
+            int velocity;
+        };
+
+        std::vector<Note> _notes;
+        std::vector<TempoChange> _tempoChanges;
+        std::vector<OpenNote> _openNotes[16 * 128]; //notes waiting for their note off, per channel and key
+        unsigned int _ticksPerBeat = 0;
+
+        static uint32_t readBigEndian(const unsigned char* data, int byteCount) {
+            uint32_t value = 0;
+            for (int i = 0; i < byteCount; i++) {
+                value = (value << 8) | data[i];
+            }
+            return value;
+        }
+
+        /*
+            Read a variable length quantity, returns false if it runs off the end of the chunk.
+        */
+        static bool readVariableLength(const unsigned char*& cursor, const unsigned char* end, uint32_t& value) {
+            value = 0;
+            for (int i = 0; i < 4; i++) {
+                if (cursor >= end)
+                    return false;
+                unsigned char byte = *cursor++;
+                value = (value << 7) | (byte & 0x7F);
+                if ((byte & 0x80) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        void noteOn(int channel, int key, int velocity, uint32_t tick) {
+            _openNotes[channel * 128 + key].push_back({tick, velocity});
+        }
+
+        void noteOff(int channel, int key, uint32_t tick) {
+            std::vector<OpenNote>& open = _openNotes[channel * 128 + key];
+            if (open.empty())
+                return;
+
+            //overlapping notes on the same key are closed first in, first out
+            OpenNote note = open.front();
+            open.erase(open.begin());
+            _notes.push_back({
+                key,
+                note.velocity,
+                (double)note.startTick / _ticksPerBeat,
+                (double)(tick - note.startTick) / _ticksPerBeat
+            });
+        }
+
+        bool readTrack(const unsigned char* cursor, const unsigned char* end) {
+            uint32_t tick = 0;
+            unsigned char runningStatus = 0;
+
+            while (cursor < end) {
+                uint32_t delta;
+                if (!readVariableLength(cursor, end, delta) || cursor >= end)
+                    return false;
+                tick += delta;
+
+                unsigned char status = *cursor;
+                if (status & 0x80) {
+                    cursor++;
+                } else if (runningStatus != 0) {
+                    status = runningStatus; //the byte is data, reuse the last channel status
+                } else {
+                    return false;
+                }
+
+                if (status == 0xFF) {
+                    //meta event
+                    if (cursor >= end)
+                        return false;
+                    unsigned char type = *cursor++;
+                    uint32_t length;
+                    if (!readVariableLength(cursor, end, length) || length > (uint32_t)(end - cursor))
+                        return false;
+
+                    if (type == 0x51 && length == 3) {
+                        uint32_t microsecondsPerBeat = readBigEndian(cursor, 3);
+                        if (microsecondsPerBeat > 0) {
+                            _tempoChanges.push_back({(double)tick / _ticksPerBeat, 60000000.0 / microsecondsPerBeat});
+                        }
+                    } else if (type == 0x2F) {
+                        break; //end of track
+                    }
+                    cursor += length;
+                    runningStatus = 0;
+                } else if (status == 0xF0 || status == 0xF7) {
+                    //sysex, skipped
+                    uint32_t length;
+                    if (!readVariableLength(cursor, end, length) || length > (uint32_t)(end - cursor))
+                        return false;
+                    cursor += length;
+                    runningStatus = 0;
+                } else {
+                    //channel message
+                    runningStatus = status;
+                    unsigned char kind = status & 0xF0;
+                    int channel = status & 0x0F;
+                    int dataLength = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+                    if (end - cursor < dataLength)
+                        return false;
+
+                    int key = cursor[0] & 0x7F;
+                    int velocity = dataLength > 1 ? (cursor[1] & 0x7F) : 0;
+                    if (kind == 0x90 && velocity > 0) {
+                        noteOn(channel, key, velocity, tick);
+                    } else if (kind == 0x80 || kind == 0x90) {
+                        noteOff(channel, key, tick);
+                    }
+                    cursor += dataLength;
+                }
+            }
+
+            //anything still held when the track ends is released there
+            for (int i = 0; i < 16 * 128; i++) {
+                while (!_openNotes[i].empty()) {
+                    noteOff(i / 128, i % 128, tick);
+                }
+            }
+            return true;
+        }
+
+    public:
+        /*
+            Parse `fileName`, returns false and prints the reason if it isn't a readable midi file.
+        */
+        bool load(const char* fileName) {
+            _notes.clear();
+            _tempoChanges.clear();
+
+            MappedFile file(fileName);
+            if (!file.isOpen()) {
+                std::cout << "Could not open " << fileName << "!" << std::endl;
+                return false;
+            }
+
+            const unsigned char* cursor = (const unsigned char*)file.data();
+            const unsigned char* end = cursor + file.size();
+            if (file.size() < 14 || readBigEndian(cursor, 4) != 0x4D546864 /* MThd */) {
+                std::cout << fileName << " is not a midi file!" << std::endl;
+                return false;
+            }
+
+            uint32_t headerLength = readBigEndian(cursor + 4, 4);
+            unsigned int format = readBigEndian(cursor + 8, 2);
+            unsigned int division = readBigEndian(cursor + 12, 2);
+            if (format > 1 || (division & 0x8000) || division == 0) {
+                std::cout << fileName << " uses an unsupported midi format or timing!" << std::endl;
+                return false;
+            }
+            _ticksPerBeat = division;
+            cursor += 8 + headerLength;
+
+            //walk the chunks, anything that isn't a track is skipped
+            while (end - cursor >= 8) {
+                uint32_t chunkType = readBigEndian(cursor, 4);
+                uint32_t chunkLength = readBigEndian(cursor + 4, 4);
+                cursor += 8;
+                if (chunkLength > (uint32_t)(end - cursor)) {
+                    std::cout << fileName << " is truncated!" << std::endl;
+                    return false;
+                }
+
+                if (chunkType == 0x4D54726B /* MTrk */ && !readTrack(cursor, cursor + chunkLength)) {
+                    std::cout << fileName << " has a malformed track!" << std::endl;
+                    return false;
+                }
+                cursor += chunkLength;
+            }
+
+            //until a file sets its tempo it plays at the standard midi file default
+            bool hasStartTempo = false;
+            for (size_t i = 0; i < _tempoChanges.size(); i++) {
+                hasStartTempo = hasStartTempo || _tempoChanges[i].startTime <= 0.0;
+            }
+            if (!hasStartTempo) {
+                _tempoChanges.insert(_tempoChanges.begin(), {0.0, 120.0});
+            }
+
+            return true;
+        }
+
+        const std::vector<Note>& getNotes() {
+            return _notes;
+        }
+
+        const std::vector<TempoChange>& getTempoChanges() {
+            return _tempoChanges;
+        }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef MIDI_INPUT_HPP
+#define MIDI_INPUT_HPP
+
+#include "./SpscQueue.hpp"
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+/*
+    Reads live midi on a thread of its own and queues the note events for the main thread, which takes
+    them with `poll()` and never waits. The input is a raw midi byte stream: an ALSA rawmidi device like
+    /dev/snd/midiC1D0, a named pipe another program writes into, or stdin.
+*/
+class MidiInput {
+    public:
+        struct Event {
+            bool isNoteOn;
+            uint8_t channel;
+            uint8_t note;
+            uint8_t velocity;
+            std::chrono::steady_clock::time_point time; //when the input thread read it
+        };
+
+    private:
+        static const size_t _queueCapacity = 1024;
+
+        SpscQueue<Event, _queueCapacity> _events;
+        std::thread _thread;
+        std::atomic<bool> _isStopping{false};
+        std::atomic<bool> _isFinished{false};
+        std::atomic<size_t> _droppedCount{0};
+        int _descriptor = -1;
+
+        //the parser's state, the running status is kept between messages so it can be left out
+        uint8_t _status = 0;
+        uint8_t _data[2] = {0, 0};
+        size_t _dataCount = 0;
+
+        //how many data bytes follow a status byte, sysex runs until its end byte instead
+        static size_t getDataLength(uint8_t status) {
+            switch (status & 0xF0) {
+                case 0xC0:
+                case 0xD0:
+                    return 1;
+                case 0xF0:
+                    if (status == 0xF1 || status == 0xF3)
+                        return 1;
+                    if (status == 0xF2)
+                        return 2;
+                    return 0;
+                default:
+                    return 2;
+            }
+        }
+
+        void queueEvent(bool isNoteOn, std::chrono::steady_clock::time_point time) {
+            Event event;
+            //a note on with no velocity is how most keyboards send a note off
+            event.isNoteOn = isNoteOn && _data[1] != 0;
+            event.channel = _status & 0x0F;
+            event.note = _data[0];
+            event.velocity = _data[1];
+            event.time = time;
+            if (!_events.push(event)) {
+                _droppedCount++;
+            }
+        }
+
+        void parse(uint8_t byte, std::chrono::steady_clock::time_point time) {
+            //realtime messages can turn up anywhere, even between a message's bytes, and carry nothing we use
+            if (byte >= 0xF8)
+                return;
+
+            if (byte & 0x80) {
+                //system messages cancel the running status, a sysex's end byte just closes it
+                _status = byte == 0xF7 ? 0 : byte;
+                _dataCount = 0;
+                return;
+            }
+
+            if (_status == 0 || _status == 0xF0)
+                return;
+            _data[_dataCount++] = byte;
+            if (_dataCount < getDataLength(_status))
+                return;
+
+            _dataCount = 0;
+            uint8_t type = _status & 0xF0;
+            if (type == 0x90 || type == 0x80) {
+                queueEvent(type == 0x90, time);
+            }
+            if (type == 0xF0) {
+                _status = 0;
+            }
+        }
+
+#ifndef _WIN32
+        void run() {
+            uint8_t buffer[256];
+            pollfd descriptor = {_descriptor, POLLIN, 0};
+            while (!_isStopping) {
+                //wake up now and then to see if it's time to stop
+                int ready = ::poll(&descriptor, 1, 50);
+                if (ready < 0 && errno != EINTR)
+                    break;
+                if (ready <= 0)
+                    continue;
+
+                ssize_t length = ::read(_descriptor, buffer, sizeof(buffer));
+                if (length < 0 && (errno == EAGAIN || errno == EINTR))
+                    continue;
+                if (length <= 0)
+                    break;
+
+                std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+                for (ssize_t i = 0; i < length; i++) {
+                    parse(buffer[i], time);
+                }
+            }
+            _isFinished = true;
+        }
+#endif
+
+    public:
+        MidiInput() {}
+
+        ~MidiInput() {
+            close();
+        }
+
+        MidiInput(const MidiInput&) = delete;
+        MidiInput& operator=(const MidiInput&) = delete;
+
+        /*
+            Start reading from `path`, "-" for stdin. Returns false if it can't be opened.
+        */
+        bool open(const char* path) {
+            close();
+#ifdef _WIN32
+            std::cout << "Live midi input isn't supported on this platform." << std::endl;
+            return false;
+#else
+            if (std::strcmp(path, "-") == 0) {
+                _descriptor = dup(STDIN_FILENO);
+            } else {
+                //a pipe is opened for writing too, so it stays open while nothing is writing into it
+                //instead of ending with the first writer
+                struct stat status;
+                bool isPipe = stat(path, &status) == 0 && S_ISFIFO(status.st_mode);
+                _descriptor = ::open(path, (isPipe ? O_RDWR : O_RDONLY) | O_NONBLOCK);
+            }
+            if (_descriptor < 0) {
+                std::cout << "Could not open " << path << " for midi input." << std::endl;
+                return false;
+            }
+
+            _status = 0;
+            _dataCount = 0;
+            _isStopping = false;
+            _isFinished = false;
+            _thread = std::thread(&MidiInput::run, this);
+            return true;
+#endif
+        }
+
+        /*
+            Stop the input thread and close the input, events still queued can be polled afterwards.
+        */
+        void close() {
+            if (_thread.joinable()) {
+                _isStopping = true;
+                _thread.join();
+            }
+#ifndef _WIN32
+            if (_descriptor >= 0) {
+                ::close(_descriptor);
+                _descriptor = -1;
+            }
+#endif
+        }
+
+        bool isOpen() {
+            return _descriptor >= 0;
+        }
+
+        /*
+            Take the oldest queued event on the main thread, returns false right away if there isn't one.
+        */
+        bool poll(Event& event) {
+            return _events.pop(event);
+        }
+
+        //whether the input has ended, after which no more events will come
+        bool isFinished() {
+            return _isFinished;
+        }
+
+        //events lost because the main thread fell too far behind to take them
+        size_t getDroppedCount() {
+            return _droppedCount;
+        }
+};
+
+#endif
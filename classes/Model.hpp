@@ -0,0 +1,293 @@
+#ifndef MODEL_HPP
+#define MODEL_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include "../helpers/globals.h"
+#include "../helpers/openGlHelpers.cpp"
+#include "./TextureAtlas.hpp"
+#include "./Shader.hpp"
+#include "./ShaderLibrary.hpp"
+
+#include <vector>
+#include <cstdint>
+
+class Model {
+    private:
+        size_t _vertexCount;
+        std::vector<float> _vertexData;
+        std::vector<uint32_t> _indexData; //three per triangle, into `_vertexData`
+        unsigned int _textureHandle = gTextureHandles::TEST;
+        float _uvTransform[4] = {1, 1, 0, 0}; //where the texture sits in the atlas, see `TextureAtlas::getUvTransform()`
+        const size_t _stride = 8;
+        float _boundsMin[3] = {0, 0, 0};
+        float _boundsMax[3] = {0, 0, 0};
+
+        //ranges of vertices that can still be moved on their own, after several models are merged into one
+        struct Part {
+            uint32_t firstVertex;
+            uint32_t vertexCount;
+            float offset[3];
+        };
+        std::vector<Part> _parts;
+        std::vector<float> _partUploadData; //reused for every part upload, so pressing keys doesn't allocate
+
+        //gpu copies of `_vertexData`, both stay 0 when the driver can't provide them
+        unsigned int _vertexBuffer = 0;
+        unsigned int _indexBuffer = 0;
+        unsigned int _vertexArray = 0;
+        bool _isUploaded = false;
+
+        /*
+            Copy some of the vertices into `vertexData` as they go to the gpu, with their texture
+            coordinates moved into the atlas.
+        */
+        void getUploadData(size_t firstVertex, size_t vertexCount, std::vector<float>& vertexData) {
+            vertexData.assign(_vertexData.begin() + firstVertex * _stride, _vertexData.begin() + (firstVertex + vertexCount) * _stride);
+            for (size_t i = 0; i < vertexData.size(); i += _stride) {
+                vertexData[i + 3] = vertexData[i + 3] * _uvTransform[0] + _uvTransform[2];
+                vertexData[i + 4] = vertexData[i + 4] * _uvTransform[1] + _uvTransform[3];
+            }
+        }
+
+        /*
+            Copy the interleaved vertex data and the indices into buffers and record their layout in a
+            vao so draw calls don't have to stream the vertices every frame.
+        */
+        void uploadVertexData() {
+            if (!GLEW_VERSION_1_5 || !(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object))
+                return;
+
+            if (_vertexBuffer == 0) {
+                glGenBuffers(1, &_vertexBuffer);
+                glGenBuffers(1, &_indexBuffer);
+                glGenVertexArrays(1, &_vertexArray);
+            }
+
+            std::vector<float> vertexData;
+            getUploadData(0, _vertexCount, vertexData);
+
+            glBindVertexArray(_vertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer); //recorded in the vao, so left bound below
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indexData.size() * sizeof(uint32_t), _indexData.data(), GL_STATIC_DRAW);
+
+            //x,y,z u,v nx,ny,nz, as shader attributes or as the fixed function arrays when there are no shaders
+            const GLsizei strideBytes = _stride * sizeof(float);
+            if (gShaders.isReady()) {
+                glEnableVertexAttribArray(ShaderLibrary::POSITION_ATTRIBUTE);
+                glEnableVertexAttribArray(ShaderLibrary::TEXCOORD_ATTRIBUTE);
+                glEnableVertexAttribArray(ShaderLibrary::NORMAL_ATTRIBUTE);
+                glVertexAttribPointer(ShaderLibrary::POSITION_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, strideBytes, (void*)0);
+                glVertexAttribPointer(ShaderLibrary::TEXCOORD_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, strideBytes, (void*)(3 * sizeof(float)));
+                glVertexAttribPointer(ShaderLibrary::NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, strideBytes, (void*)(5 * sizeof(float)));
+            } else {
+                glEnableClientState(GL_VERTEX_ARRAY);
+                glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+                glEnableClientState(GL_NORMAL_ARRAY);
+                glVertexPointer(3, GL_FLOAT, strideBytes, (void*)0);
+                glTexCoordPointer(2, GL_FLOAT, strideBytes, (void*)(3 * sizeof(float)));
+                glNormalPointer(GL_FLOAT, strideBytes, (void*)(5 * sizeof(float)));
+            }
+
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+    public:
+        float pos[3] = {0, 0, 0};
+
+        ~Model() {
+            if (_vertexBuffer != 0) {
+                glDeleteVertexArrays(1, &_vertexArray);
+                glDeleteBuffers(1, &_vertexBuffer);
+                glDeleteBuffers(1, &_indexBuffer);
+            }
+        }
+
+        size_t getVertexCount() {
+            return _vertexCount;
+        }
+
+        /*
+            Set the texture to draw with. `hasAtlasCoordinates` is for vertex data whose texture
+            coordinates already point into the atlas, like that of merged models.
+        */
+        void setTextureHandle(unsigned int textureHandle, bool hasAtlasCoordinates = false) {
+            _textureHandle = textureHandle;
+            TextureAtlas::getUvTransform(textureHandle, _uvTransform);
+            if (hasAtlasCoordinates) {
+                _uvTransform[0] = 1.0f;
+                _uvTransform[1] = 1.0f;
+                _uvTransform[2] = 0.0f;
+                _uvTransform[3] = 0.0f;
+            }
+            _isUploaded = false;
+        }
+
+        unsigned int getTextureHandle() {
+            return _textureHandle;
+        }
+
+        const float* getUvTransform() {
+            return _uvTransform;
+        }
+
+        const std::vector<float>& getVertexData() {
+            return _vertexData;
+        }
+
+        const std::vector<uint32_t>& getIndexData() {
+            return _indexData;
+        }
+
+        size_t getIndexCount() {
+            return _indexData.size();
+        }
+
+        //axis aligned box around the vertices, before `pos` is applied
+        const float* getBoundsMin() {
+            return _boundsMin;
+        }
+
+        const float* getBoundsMax() {
+            return _boundsMax;
+        }
+
+        void setBounds(const float boundsMin[3], const float boundsMax[3]) {
+            for (int axis = 0; axis < 3; axis++) {
+                _boundsMin[axis] = boundsMin[axis];
+                _boundsMax[axis] = boundsMax[axis];
+            }
+        }
+
+        /*
+            Set the unique x,y,z u,v nx,ny,nz vertices and the indices of the triangles that use them.
+            Nothing is sent to the gpu until `upload()`, so models can be built on any thread.
+        */
+        void setVertexData(std::vector<float> vertexData, std::vector<uint32_t> indexData) {
+            _vertexData = std::move(vertexData);
+            _indexData = std::move(indexData);
+            _vertexCount = _vertexData.size() / _stride;
+            _isUploaded = false;
+        }
+
+        /*
+            Mark `vertexCount` vertices from `firstVertex` as a part that can be moved with
+            `setPartOffset()`, returns the part's index.
+        */
+        size_t addPart(size_t firstVertex, size_t vertexCount) {
+            _parts.push_back({(uint32_t)firstVertex, (uint32_t)vertexCount, {0, 0, 0}});
+            return _parts.size() - 1;
+        }
+
+        /*
+            Move a part to `offset` from where it was built. Only the part's vertices are sent to the gpu
+            again, and only when the offset changes.
+        */
+        void setPartOffset(size_t partIndex, const float offset[3]) {
+            Part& part = _parts.at(partIndex);
+            float delta[3] = {offset[0] - part.offset[0], offset[1] - part.offset[1], offset[2] - part.offset[2]};
+            if (delta[0] == 0.0f && delta[1] == 0.0f && delta[2] == 0.0f)
+                return;
+
+            for (size_t i = part.firstVertex * _stride; i < (part.firstVertex + part.vertexCount) * _stride; i += _stride) {
+                _vertexData[i] += delta[0];
+                _vertexData[i + 1] += delta[1];
+                _vertexData[i + 2] += delta[2];
+            }
+            part.offset[0] = offset[0];
+            part.offset[1] = offset[1];
+            part.offset[2] = offset[2];
+
+            if (_isUploaded && _vertexBuffer != 0) {
+                getUploadData(part.firstVertex, part.vertexCount, _partUploadData);
+                glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+                glBufferSubData(GL_ARRAY_BUFFER, part.firstVertex * _stride * sizeof(float), _partUploadData.size() * sizeof(float), _partUploadData.data());
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+        }
+
+        /*
+            Send the vertex data to the gpu if it changed, needs the gl context. Drawing uploads on
+            demand, calling this ahead of time keeps it out of the first frame.
+        */
+        void upload() {
+            if (!_isUploaded) {
+                uploadVertexData();
+                _isUploaded = true;
+            }
+        }
+
+        unsigned int getTexture() {
+            return gTextures[_textureHandle];
+        }
+
+        /*
+            Draw the triangles with whatever texture and transform are current. The model's vertex
+            array is left bound so repeated draws of it don't rebind, callers unbind when they're done.
+        */
+        void drawMesh() {
+            upload();
+
+            if (_vertexArray != 0) {
+                glBindVertexArray(_vertexArray);
+                glDrawElements(GL_TRIANGLES, (GLsizei)_indexData.size(), GL_UNSIGNED_INT, (void*)0);
+            } else {
+                //immediate mode fallback for drivers without buffer objects
+                glBegin(GL_TRIANGLES);
+                for (uint32_t index : _indexData) {
+                    size_t i = index * _stride;
+                    glTexCoord2f(_vertexData[i + 3] * _uvTransform[0] + _uvTransform[2], _vertexData[i + 4] * _uvTransform[1] + _uvTransform[3]);
+                    glNormal3f(_vertexData[i + 5], _vertexData[i + 6], _vertexData[i + 7]);
+                    glVertex3f(_vertexData[i], _vertexData[i + 1], _vertexData[i + 2]);
+                }
+                glEnd();
+            }
+        }
+
+        /*
+            Draw at `pos`, through the current shader's `translation` uniform when there is one.
+        */
+        void draw() {
+            Shader* shader = Shader::getCurrent();
+            if (shader != nullptr) {
+                shader->setUniform3("translation", pos);
+            } else {
+                glPushMatrix();
+                glTranslatef(pos[0], pos[1], pos[2]);
+            }
+
+            bindTexture(getTexture());
+            drawMesh();
+            if (_vertexArray != 0) {
+                glBindVertexArray(0);
+            }
+
+            if (shader == nullptr) {
+                glPopMatrix();
+            }
+        }
+
+        unsigned int getVertexArray() {
+            upload();
+            return _vertexArray;
+        }
+
+        /*
+            Draw `instanceCount` copies of the model in one call, it's up to the caller to bind a shader
+            and attach per instance attributes to the vertex array.
+        */
+        void drawInstanced(size_t instanceCount) {
+            upload();
+            bindTexture(gTextures[_textureHandle]);
+            glBindVertexArray(_vertexArray);
+            glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)_indexData.size(), GL_UNSIGNED_INT, (void*)0, (GLsizei)instanceCount);
+            glBindVertexArray(0);
+        }
+};
+
+#endif
@@ -7,48 +7,39 @@
 
 #include "../helpers/openGlHelpers.cpp"
 #include "../classes/Model.hpp"
+#include "./ObjLoader.hpp"
+#include "./MeshIndexer.hpp"
+#include "./MeshCache.hpp"
 
 #include <vector>
 #include <array>
 #include <string>
-#include <iostream>
-#include <fstream>
 #include <cmath>
+#include <filesystem>
 
 class ModelFactory {
 private:
-    static Model* createModelWithVertexData(std::vector<float> vertices) {
+    static Model* createModelWithMesh(std::vector<float> vertices, std::vector<uint32_t> indices, const float boundsMin[3], const float boundsMax[3]) {
         Model* newModel = new Model;
-        newModel->setVertexData(vertices);
+        newModel->setVertexData(std::move(vertices), std::move(indices));
+        newModel->setBounds(boundsMin, boundsMax);
         return newModel;
     }
 
-    static void readFace(std::vector<std::string> tokens, std::vector<std::array<float, 3>>& v, std::vector<std::array<float, 2>>& vt, std::vector<std::array<float, 3>>& vn, std::vector<float>& vertices) {
-        size_t triangleCount = tokens.size() - 3;
-
-        for (size_t i = 0; i < triangleCount; i++) {
-            readCorner(tokens[1], v, vt, vn, vertices);
-            readCorner(tokens[2 + i], v, vt, vn, vertices);
-            readCorner(tokens[3 + i], v, vt, vn, vertices);
+    /*
+        Index a triangle soup, sharing the vertices it repeats, and hand it to a new model.
+    */
+    static Model* createModelWithVertexData(const std::vector<float>& soup) {
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        MeshIndexer::index(soup, 8, vertices, indices);
+        if (shouldOptimizeVertexCache) {
+            MeshIndexer::optimizeVertexCache(vertices, 8, indices);
         }
-    }
-
-    static void readCorner(std::string description, std::vector<std::array<float, 3>>& v, std::vector<std::array<float, 2>>& vt, std::vector<std::array<float, 3>>& vn, std::vector<float>& vertices) {
-        std::vector<std::string> v_vt_vn = split(description, "/");
-
-        long posIndex = std::stol(v_vt_vn[0]) - 1;
-        vertices.push_back(v.at(posIndex)[0]);
-        vertices.push_back(v.at(posIndex)[1]);
-        vertices.push_back(v.at(posIndex)[2]);
-
-        long texcoordIndex = std::stol(v_vt_vn[1]) - 1;
-        vertices.push_back(vt.at(texcoordIndex)[0]);
-        vertices.push_back(vt.at(texcoordIndex)[1]);
 
-        long normalIndex = std::stol(v_vt_vn[2]) - 1;
-        vertices.push_back(vn.at(normalIndex)[0]);
-        vertices.push_back(vn.at(normalIndex)[1]);
-        vertices.push_back(vn.at(normalIndex)[2]);
+        float boundsMin[3], boundsMax[3];
+        MeshCache::computeBounds(vertices, 8, boundsMin, boundsMax);
+        return createModelWithMesh(std::move(vertices), std::move(indices), boundsMin, boundsMax);
     }
 
     static void computeNormal(float normal[], float a[], float b[], float c[]) {
@@ -165,69 +156,41 @@ private:
     }
 
 public:
-    static Model* fromObj(const char* fileName) {
-        std::vector<std::array<float, 3>> v; //vertex positions
-        std::vector<std::array<float, 2>> vt; //texcoords
-        std::vector<std::array<float, 3>> vn; //vertex normals
-        std::vector<float> vertices;
-
-        size_t vertexCount = 0;
-        size_t texcoordCount = 0;
-        size_t normalCount = 0;
-        size_t triangleCount = 0;
+    //reorder triangles for the post transform vertex cache when building models
+    static inline bool shouldOptimizeVertexCache = true;
 
-        std::ifstream file;
-        std::string line;
-        std::vector<std::string> tokens;
+    /*
+        Load a wavefront .obj, through the cooked .mvmesh next to it when that's still current. A cooked
+        mesh without its .obj is used as is, so deployments can ship only the cooked form.
+    */
+    static Model* fromObj(const char* fileName) {
+        std::string cacheName = std::string(fileName) + ".mvmesh";
+        std::error_code error;
+        bool hasSource = std::filesystem::exists(fileName, error);
+
+        MeshCache cache;
+        if (cache.load(cacheName.c_str(), hasSource ? fileName : nullptr, 8)) {
+            const MeshCache::Header& header = cache.getHeader();
+            std::vector<float> vertices(cache.getVertices(), cache.getVertices() + header.vertexCount * 8);
+            if (header.indexCount == 0)
+                return createModelWithVertexData(vertices);
+
+            std::vector<uint32_t> indices(cache.getIndices(), cache.getIndices() + header.indexCount);
+            return createModelWithMesh(std::move(vertices), std::move(indices), header.boundsMin, header.boundsMax);
+        }
 
-        //read the file once to reserve space for each vector
-        file.open(fileName);
-        if (!file.is_open()) {
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        ObjLoader loader;
+        if (!loader.load(fileName, vertices, indices, shouldOptimizeVertexCache)) {
             gShouldExit = true;
-            std::cout << "Could not open " << fileName << "!" << std::endl;
             return nullptr;
         }
+        MeshCache::write(cacheName.c_str(), fileName, vertices, 8, indices);
 
-        while (std::getline(file, line)) {
-            tokens = split(line, " ");
-
-            if (!tokens[0].compare("v")) {
-                vertexCount += 1;
-            } else if (!tokens[0].compare("vt")) {
-                texcoordCount += 1;
-            } else if (!tokens[0].compare("vn")) {
-                normalCount += 1;
-            } else if (!tokens[0].compare("f")) {
-                triangleCount += tokens.size() - 3;
-            }
-        }
-        file.close();
-
-        //reserve space for each vector
-        v.reserve(vertexCount);
-        vt.reserve(texcoordCount);
-        vn.reserve(normalCount);
-        vertices.reserve(triangleCount * 3 * 8);
-
-        //read throigh the file again and store the actual data in the allocated space
-        file.open(fileName);
-        while (std::getline(file, line)) {
-            tokens = split(line, " ");
-
-            if (!tokens[0].compare("v")) {
-                v.push_back({ std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3]) });
-            } else if (!tokens[0].compare("vt")) {
-                vt.push_back({ std::stof(tokens[1]), std::stof(tokens[2]) });
-            } else if (!tokens[0].compare("vn")) {
-                vn.push_back({ std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3]) });
-            } else if (!tokens[0].compare("f")) {
-                //read face
-                readFace(tokens, v, vt, vn, vertices);
-            }
-        }
-        file.close();
-
-        return createModelWithVertexData(vertices);
+        float boundsMin[3], boundsMax[3];
+        MeshCache::computeBounds(vertices, 8, boundsMin, boundsMax);
+        return createModelWithMesh(std::move(vertices), std::move(indices), boundsMin, boundsMax);
     }
 
     static Model* fromCenteredCuboid(float w, float h, float d) {
@@ -379,57 +342,6 @@ public:
         return createModelWithVertexData(vertexData);
     }
 
-static Model* fromNote(float w, float h, float d) {
-        float a = 0.027f;
-
-        std::vector<float> cuboidVertexData = {
-            w - a, h, a, 1.0f, 1.0f,  0.0f,  0.0f, -1.0f,
-            w, 0, 0, 1.0f, 0.0f,  0.0f,  0.0f, -1.0f,
-            0, 0, 0, 0.0f, 0.0f,  0.0f,  0.0f, -1.0f,
-            0, 0, 0, 0.0f, 0.0f,  0.0f,  0.0f, -1.0f,
-            a, h, a, 0.0f, 1.0f,  0.0f,  0.0f, -1.0f,
-            w - a, h, a, 1.0f, 1.0f,  0.0f,  0.0f, -1.0f,
-
-            0, 0, d, 0.0f, 0.0f,  0.0f,  0.0f,  1.0f,
-            w, 0, d, 1.0f, 0.0f,  0.0f,  0.0f,  1.0f,
-            w - a, h, d - a, 1.0f, 1.0f,  0.0f,  0.0f,  1.0f,
-            w - a, h, d - a, 1.0f, 1.0f,  0.0f,  0.0f,  1.0f,
-            a, h, d - a, 0.0f, 1.0f,  0.0f,  0.0f,  1.0f,
-            0, 0, d, 0.0f, 0.0f,  0.0f,  0.0f,  1.0f,
-
-            a, h, d - a, 1.0f, 1.0f, -1.0f,  0.0f,  0.0f,
-            a, h, a, 1.0f, 0.0f, -1.0f,  0.0f,  0.0f,
-            0, 0, 0, 0.0f, 0.0f, -1.0f,  0.0f,  0.0f,
-            0, 0, 0, 0.0f, 0.0f, -1.0f,  0.0f,  0.0f,
-            0, 0, d, 0.0f, 1.0f, -1.0f,  0.0f,  0.0f,
-            a, h, d - a, 1.0f, 1.0f, -1.0f,  0.0f,  0.0f,
-
-            w, 0, 0, 0.0f, 0.0f,  1.0f,  0.0f,  0.0f,
-            w - a, h, a, 1.0f, 0.0f,  1.0f,  0.0f,  0.0f,
-            w - a, h, d - a, 1.0f, 1.0f,  1.0f,  0.0f,  0.0f,
-            w - a, h, d - a, 1.0f, 1.0f,  1.0f,  0.0f,  0.0f,
-            w, 0, d, 0.0f, 1.0f,  1.0f,  0.0f,  0.0f,
-            w, 0, 0, 0.0f, 0.0f,  1.0f,  0.0f,  0.0f,
-
-            0, 0, 0, 0.0f, 0.0f,  0.0f, -1.0f,  0.0f,
-            w, 0, 0, 1.0f, 0.0f,  0.0f, -1.0f,  0.0f,
-            w, 0, d, 1.0f, 1.0f,  0.0f, -1.0f,  0.0f,
-            w, 0, d, 1.0f, 1.0f,  0.0f, -1.0f,  0.0f,
-            0, 0, d, 0.0f, 1.0f,  0.0f, -1.0f,  0.0f,
-            0, 0, 0, 0.0f, 0.0f,  0.0f, -1.0f,  0.0f,
-
-
-            w - a, h, d - a, 1.0f, 1.0f,  0.0f,  1.0f,  0.0f,
-            w - a, h, a, 1.0f, 0.0f,  0.0f,  1.0f,  0.0f,
-            a, h, a, 0.0f, 0.0f,  0.0f,  1.0f,  0.0f,
-            a, h, a, 0.0f, 0.0f,  0.0f,  1.0f,  0.0f,
-            a, h, d - a, 0.0f, 1.0f,  0.0f,  1.0f,  0.0f,
-            w - a, h, d -a, 1.0f, 1.0f,  0.0f,  1.0f,  0.0f
-        };
-
-        return createModelWithVertexData(cuboidVertexData);
-    }
-
     static Model* fromLampPost(float baseRadius, float baseHeight, float postRadius, float postHeight) {
         std::vector<float> vertexData;
         std::vector<float> baseVertexData = createCylinderVertexData(6, baseRadius, baseRadius, 0, baseHeight, false, 0, true, baseHeight * 2);
@@ -0,0 +1,328 @@
+#ifndef NOTE_RENDERER_HPP
+#define NOTE_RENDERER_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include "../helpers/openGlHelpers.cpp"
+#include "../helpers/globals.h"
+#include "./Model.hpp"
+#include "./ModelFactory.hpp"
+#include "./Shader.hpp"
+#include "./ShaderLibrary.hpp"
+#include "./KeyStates.hpp"
+#include "./Piano.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Draws the song's falling notes as instances of one shared unit box. The notes are uploaded once as
+    static instance data and animated in the vertex shader from the song time, so a frame costs the same
+    however long the song is.
+*/
+class NoteRenderer {
+    public:
+        //a note as the song keeps it in memory and in its cache, uploaded as is for the shader to read
+        struct Note {
+            float startTime;
+            float duration;
+            int32_t keyIndex;
+            int32_t velocity;
+            float color[3];
+        };
+
+        //where the notes for a key are drawn
+        struct KeyPlacement {
+            float x;
+            float z;
+            float width;
+            float brightness;
+        };
+
+    private:
+        Model* _mesh;
+        const Note* _notes = nullptr; //owned by the song
+        size_t _noteCount = 0;
+        std::vector<KeyPlacement> _keys;
+        Shader* _shader = nullptr; //owned by `gShaders`
+        unsigned int _instanceBuffer = 0;
+        bool _areKeysSet = false;
+        uint32_t _keyStatesVersion = 0; //of the key states last given to the shader
+
+        //notes reach the keys at `_playLine` and are cut off at the top of the keys, their top face is
+        //pulled in to give a bevel
+        const float _playLine = 3.18f;
+        const float _keyPlane = 3.175f;
+        const float _bevel = 0.027f;
+
+        static const unsigned int _timingAttribute = 3;
+        static const unsigned int _keyAttribute = 4;
+        static const unsigned int _colorAttribute = 5;
+        static const int _maxKeyCount = 128;
+        float _keyUniforms[_maxKeyCount * 4] = {};
+
+        //sounding notes glow, from twice to three times as bright as the key is struck harder
+        const float _minGlow = 2.0f;
+        const float _maxGlow = 3.0f;
+
+        //the shared header with the version and camera block is added by `ShaderLibrary::load()`
+        const char* _vertexSource = R"(
+            layout(location = 0) in vec3 vertexPosition;
+            layout(location = 1) in vec2 vertexTexcoord;
+            layout(location = 3) in vec2 noteTiming; //start time, duration
+            layout(location = 4) in int noteKey;
+            layout(location = 5) in vec3 noteColor;
+            uniform vec4 keys[128]; //x, z, width, velocity of the note holding the key down
+            uniform uvec4 activeKeys; //a bit per key, set while it's held down
+            uniform float songTime;
+            uniform float playLine;
+            uniform float keyPlane;
+            uniform float bevel;
+            uniform float minGlow;
+            uniform float maxGlow;
+            out vec2 texcoord;
+            out vec3 tint;
+
+            void main() {
+                vec4 key = keys[noteKey];
+                vec3 origin = vec3(key.x, playLine + noteTiming.x - songTime, key.y);
+                vec3 size = vec3(key.z, noteTiming.y, key.z * 0.75);
+
+                vec3 position = vertexPosition * size;
+                if (vertexPosition.y > 0.5) {
+                    position.xz += mix(vec2(bevel), vec2(-bevel), vertexPosition.xz);
+                }
+                position += origin;
+                position.y = max(position.y, keyPlane);
+
+                //notes that have finished collapse to a point and aren't drawn
+                if (noteTiming.x + noteTiming.y < songTime) {
+                    position = origin;
+                }
+
+                //the note the playhead is in lights up while its key is held
+                bool isKeyActive = (activeKeys[noteKey / 32] & (1u << uint(noteKey % 32))) != 0u;
+                bool isSounding = isKeyActive && noteTiming.x <= songTime && songTime < noteTiming.x + noteTiming.y;
+                float glow = isSounding ? mix(minGlow, maxGlow, key.w / 127.0) : 1.0;
+
+                gl_Position = camera.projection * camera.view * vec4(position, 1.0);
+                texcoord = vertexTexcoord;
+                tint = clamp(noteColor * glow, 0.0, 1.0);
+            }
+        )";
+
+        const char* _fragmentSource = R"(
+            uniform sampler2D noteTexture;
+            in vec2 texcoord;
+            in vec3 tint;
+            out vec4 fragColor;
+
+            void main() {
+                fragColor = texture(noteTexture, texcoord) * vec4(tint, 1.0);
+            }
+        )";
+
+        /*
+            Build the shader and attach the instance buffer to the mesh's vertex array, leaves `_shader`
+            null without shaders so `draw()` falls back to one draw per note.
+        */
+        void createInstancePipeline() {
+            if (!gShaders.isReady() || _mesh->getVertexArray() == 0)
+                return;
+
+            _shader = gShaders.load("note", _vertexSource, _fragmentSource);
+            if (_shader == nullptr)
+                return;
+
+            glGenBuffers(1, &_instanceBuffer);
+            glBindVertexArray(_mesh->getVertexArray());
+            glEnableVertexAttribArray(_timingAttribute);
+            glVertexAttribDivisor(_timingAttribute, 1);
+            glEnableVertexAttribArray(_keyAttribute);
+            glVertexAttribDivisor(_keyAttribute, 1);
+            glEnableVertexAttribArray(_colorAttribute);
+            glVertexAttribDivisor(_colorAttribute, 1);
+            glBindVertexArray(0);
+        }
+
+        /*
+            Point the instance attributes at the notes from `firstNote` on, so drawing the window of
+            visible notes doesn't need base instances.
+        */
+        void setFirstInstance(size_t firstNote) {
+            const size_t offset = firstNote * sizeof(Note);
+            glBindVertexArray(_mesh->getVertexArray());
+            glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+            glVertexAttribPointer(_timingAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Note), (void*)(offset + offsetof(Note, startTime)));
+            glVertexAttribIPointer(_keyAttribute, 1, GL_INT, sizeof(Note), (void*)(offset + offsetof(Note, keyIndex)));
+            glVertexAttribPointer(_colorAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(Note), (void*)(offset + offsetof(Note, color)));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+        }
+
+        //how much brighter a note is drawn, when it's sounding
+        float getGlow(const Note& note, double songTime, const KeyStates& keyStates) {
+            if (!keyStates.isActive(note.keyIndex) || note.startTime > songTime || note.startTime + note.duration <= songTime)
+                return 1.0f;
+            return _minGlow + (_maxGlow - _minGlow) * (keyStates.getVelocity(note.keyIndex) / 127.0f);
+        }
+
+        void drawInstances(double songTime, size_t firstNote, size_t noteCount, const KeyStates& keyStates) {
+            _shader->use();
+            if (!_areKeysSet) {
+                for (size_t i = 0; i < _keys.size() && i < (size_t)_maxKeyCount; i++) {
+                    _keyUniforms[i * 4] = _keys[i].x;
+                    _keyUniforms[i * 4 + 1] = _keys[i].z;
+                    _keyUniforms[i * 4 + 2] = _keys[i].width;
+                }
+                _shader->setUniform("playLine", _playLine);
+                _shader->setUniform("keyPlane", _keyPlane);
+                _shader->setUniform("bevel", _bevel);
+                _shader->setUniform("minGlow", _minGlow);
+                _shader->setUniform("maxGlow", _maxGlow);
+            }
+
+            //the held keys only change when a note starts or ends
+            if (!_areKeysSet || keyStates.getVersion() != _keyStatesVersion) {
+                unsigned int activeKeys[4] = {0, 0, 0, 0};
+                for (size_t i = 0; i < _keys.size() && i < (size_t)_maxKeyCount; i++) {
+                    bool isActive = keyStates.isActive(i);
+                    _keyUniforms[i * 4 + 3] = isActive ? (float)keyStates.getVelocity(i) : 0.0f;
+                    activeKeys[i / 32] |= isActive ? 1u << (i % 32) : 0u;
+                }
+                glUniform4fv(_shader->getUniformLocation("keys"), _maxKeyCount, _keyUniforms);
+                glUniform4uiv(_shader->getUniformLocation("activeKeys"), 1, activeKeys);
+                _keyStatesVersion = keyStates.getVersion();
+                _areKeysSet = true;
+            }
+            _shader->setUniform("songTime", (float)songTime);
+
+            setFirstInstance(firstNote);
+            _mesh->drawInstanced(noteCount);
+        }
+
+        /*
+            One draw per note for drivers without shaders, placed on the cpu. The key plane becomes a user
+            clip plane.
+        */
+        void drawEachInstance(double songTime, size_t firstNote, size_t noteCount, const KeyStates& keyStates) {
+            Shader::useNone();
+            for (size_t i = firstNote; i < firstNote + noteCount; i++) {
+                const Note& note = _notes[i];
+                if (note.startTime + note.duration < songTime)
+                    continue;
+
+                const KeyPlacement& key = _keys[note.keyIndex];
+                float y = _playLine + (note.startTime - songTime);
+                glPushMatrix();
+                glTranslatef(key.x, y, key.z);
+
+                double keyPlane[4] = {0.0, 1.0, 0.0, y - _keyPlane};
+                glClipPlane(GL_CLIP_PLANE0, keyPlane);
+                glEnable(GL_CLIP_PLANE0);
+
+                glScalef(key.width, note.duration, key.width * 0.75f);
+                float glow = getGlow(note, songTime, keyStates);
+                glColor3f(note.color[0] * glow, note.color[1] * glow, note.color[2] * glow);
+                _mesh->draw();
+
+                glDisable(GL_CLIP_PLANE0);
+                glPopMatrix();
+            }
+            glColor3f(1.0f, 1.0f, 1.0f);
+        }
+
+    public:
+        /*
+            Where the notes for each of `piano`'s keys are drawn, the notes of black keys are set back
+            and darker.
+        */
+        static std::vector<KeyPlacement> placeKeys(Piano* piano) {
+            std::vector<KeyPlacement> keys;
+            size_t keyCount = piano->getLayout().size();
+            for (size_t i = 0; i < keyCount; i++) {
+                KeyPlacement key;
+                key.x = piano->getKeyX(i);
+                key.z = 1.6f;
+                key.width = piano->getWhiteKeyWidth();
+                key.brightness = 1.15f;
+                if (piano->isBlackKey(i)) {
+                    key.z -= 0.45f;
+                    key.width = piano->getBlackKeyWidth();
+                    key.brightness = 0.8f;
+                }
+                keys.push_back(key);
+            }
+            return keys;
+        }
+
+        /*
+            Give a note a colour based on where its key is on the piano.
+        */
+        static void colorNote(Note& note, const std::vector<KeyPlacement>& keys) {
+            float brightness = keys[note.keyIndex].brightness;
+            float r = ((float)note.keyIndex / (float)keys.size());
+            float g = 0.2f;
+            float b = 1.0f - r;
+            note.color[0] = r * brightness;
+            note.color[1] = g * brightness;
+            note.color[2] = b * brightness;
+        }
+
+        NoteRenderer() {
+            _mesh = ModelFactory::fromAnchoredCuboid(1.0f, 1.0f, 1.0f);
+            _mesh->setTextureHandle(gTextureHandles::NOTE);
+            createInstancePipeline();
+        }
+
+        ~NoteRenderer() {
+            if (_instanceBuffer != 0) {
+                glDeleteBuffers(1, &_instanceBuffer);
+            }
+            delete _mesh;
+        }
+
+        /*
+            Where each key's notes are drawn, indexed by `Note::keyIndex`.
+        */
+        void setKeys(const std::vector<KeyPlacement>& keys) {
+            _keys = keys;
+            _areKeysSet = false;
+        }
+
+        /*
+            Upload the song's notes, sorted by start time. They're read again by the fallback, so they
+            have to outlive the renderer or the next call. `isStreaming` is for notes that are replaced
+            every frame.
+        */
+        void setNotes(const Note* notes, size_t noteCount, bool isStreaming = false) {
+            _notes = notes;
+            _noteCount = noteCount;
+            if (_shader != nullptr) {
+                glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+                glBufferData(GL_ARRAY_BUFFER, noteCount * sizeof(Note), notes, isStreaming ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+        }
+
+        /*
+            Draw `noteCount` notes from `firstNote` at `songTime`, in beats. Notes outside that range
+            aren't touched, so the cost only depends on how many could be on screen. Sounding notes on
+            the keys held down in `keyStates` glow.
+        */
+        void draw(double songTime, size_t firstNote, size_t noteCount, const KeyStates& keyStates) {
+            if (noteCount == 0 || firstNote + noteCount > _noteCount)
+                return;
+
+            if (_shader != nullptr) {
+                drawInstances(songTime, firstNote, noteCount, keyStates);
+            } else {
+                drawEachInstance(songTime, firstNote, noteCount, keyStates);
+            }
+        }
+};
+
+#endif
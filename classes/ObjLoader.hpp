@@ -0,0 +1,216 @@
+#ifndef OBJ_LOADER_HPP
+#define OBJ_LOADER_HPP
+
+#include "./MappedFile.hpp"
+#include "./MeshIndexer.hpp"
+
+#include <vector>
+#include <array>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+
+/*
+    Reads the triangles out of a wavefront .obj file in a single pass over the mapped file. Faces are
+    fanned into triangles and written as interleaved x,y,z u,v nx,ny,nz vertices, the layout `Model` uses.
+*/
+class ObjLoader {
+    private:
+        struct Corner {
+            long position;
+            long texcoord; //-1 when the face doesn't give one
+            long normal; //-1 when the face doesn't give one
+        };
+
+        std::vector<std::array<float, 3>> _positions;
+        std::vector<std::array<float, 2>> _texcoords;
+        std::vector<std::array<float, 3>> _normals;
+        std::vector<Corner> _faceCorners;
+        size_t _skippedFaces = 0;
+
+        static bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        /*
+            Split off the next whitespace separated word of `line`.
+        */
+        static std::string_view nextWord(std::string_view& line) {
+            size_t start = 0;
+            while (start < line.size() && isSpace(line[start])) {
+                start++;
+            }
+            size_t end = start;
+            while (end < line.size() && !isSpace(line[end])) {
+                end++;
+            }
+            std::string_view word = line.substr(start, end - start);
+            line.remove_prefix(end);
+            return word;
+        }
+
+        static float readFloat(std::string_view& line) {
+            std::string_view word = nextWord(line);
+            float value = 0.0f;
+            std::from_chars(word.data(), word.data() + word.size(), value);
+            return value;
+        }
+
+        /*
+            Turn a 1 based (or negative, relative to the end) obj index into a 0 based one, -1 if it's
+            out of range or missing.
+        */
+        static long resolveIndex(std::string_view text, size_t count) {
+            long index = 0;
+            std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), index);
+            if (text.empty() || result.ec != std::errc())
+                return -1;
+
+            index = index < 0 ? (long)count + index : index - 1;
+            return (index >= 0 && index < (long)count) ? index : -1;
+        }
+
+        /*
+            Read a "v", "v/vt", "v//vn" or "v/vt/vn" face corner.
+        */
+        bool readCorner(std::string_view word, Corner& corner) {
+            size_t firstSlash = word.find('/');
+            corner.position = resolveIndex(word.substr(0, firstSlash), _positions.size());
+            corner.texcoord = -1;
+            corner.normal = -1;
+            if (firstSlash != std::string_view::npos) {
+                std::string_view rest = word.substr(firstSlash + 1);
+                size_t secondSlash = rest.find('/');
+                corner.texcoord = resolveIndex(rest.substr(0, secondSlash), _texcoords.size());
+                if (secondSlash != std::string_view::npos) {
+                    corner.normal = resolveIndex(rest.substr(secondSlash + 1), _normals.size());
+                }
+            }
+            return corner.position >= 0;
+        }
+
+        void writeVertex(const Corner& corner, const float faceNormal[3], std::vector<float>& vertices) {
+            const std::array<float, 3>& position = _positions[corner.position];
+            vertices.insert(vertices.end(), position.begin(), position.end());
+
+            if (corner.texcoord >= 0) {
+                vertices.insert(vertices.end(), _texcoords[corner.texcoord].begin(), _texcoords[corner.texcoord].end());
+            } else {
+                vertices.insert(vertices.end(), {0.0f, 0.0f});
+            }
+
+            if (corner.normal >= 0) {
+                vertices.insert(vertices.end(), _normals[corner.normal].begin(), _normals[corner.normal].end());
+            } else {
+                vertices.insert(vertices.end(), faceNormal, faceNormal + 3);
+            }
+        }
+
+        /*
+            Fan a face into triangles, corners without a normal get the flat normal of their triangle.
+        */
+        void readFace(std::string_view line, std::vector<float>& vertices) {
+            _faceCorners.clear();
+            for (std::string_view word = nextWord(line); !word.empty(); word = nextWord(line)) {
+                Corner corner;
+                if (!readCorner(word, corner)) {
+                    _skippedFaces++;
+                    return;
+                }
+                _faceCorners.push_back(corner);
+            }
+
+            for (size_t i = 2; i < _faceCorners.size(); i++) {
+                const Corner* triangle[3] = {&_faceCorners[0], &_faceCorners[i - 1], &_faceCorners[i]};
+
+                float faceNormal[3] = {0.0f, 1.0f, 0.0f};
+                if (triangle[0]->normal < 0 || triangle[1]->normal < 0 || triangle[2]->normal < 0) {
+                    computeFaceNormal(faceNormal, _positions[triangle[0]->position], _positions[triangle[1]->position], _positions[triangle[2]->position]);
+                }
+
+                for (int corner = 0; corner < 3; corner++) {
+                    writeVertex(*triangle[corner], faceNormal, vertices);
+                }
+            }
+        }
+
+        static void computeFaceNormal(float normal[3], const std::array<float, 3>& a, const std::array<float, 3>& b, const std::array<float, 3>& c) {
+            float u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            float v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            float n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length > 0.0f) {
+                normal[0] = n[0] / length;
+                normal[1] = n[1] / length;
+                normal[2] = n[2] / length;
+            }
+        }
+
+    public:
+        /*
+            Parse `fileName` into `vertices`, returns false if the file can't be opened.
+        */
+        bool load(const char* fileName, std::vector<float>& vertices) {
+            MappedFile file(fileName);
+            if (!file.isOpen()) {
+                std::cout << "Could not open " << fileName << "!" << std::endl;
+                return false;
+            }
+
+            _positions.clear();
+            _texcoords.clear();
+            _normals.clear();
+            _skippedFaces = 0;
+
+            std::string_view text(file.data(), file.size());
+            while (!text.empty()) {
+                size_t lineEnd = text.find('\n');
+                std::string_view line = text.substr(0, lineEnd);
+                text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+
+                std::string_view keyword = nextWord(line);
+                if (keyword == "v") {
+                    float x = readFloat(line);
+                    float y = readFloat(line);
+                    float z = readFloat(line);
+                    _positions.push_back({x, y, z});
+                } else if (keyword == "vt") {
+                    float u = readFloat(line);
+                    float v = readFloat(line);
+                    _texcoords.push_back({u, v});
+                } else if (keyword == "vn") {
+                    float x = readFloat(line);
+                    float y = readFloat(line);
+                    float z = readFloat(line);
+                    _normals.push_back({x, y, z});
+                } else if (keyword == "f") {
+                    readFace(line, vertices);
+                }
+            }
+
+            if (_skippedFaces > 0) {
+                std::cout << "Skipped " << _skippedFaces << " faces with bad indices in " << fileName << "." << std::endl;
+            }
+            return true;
+        }
+
+        /*
+            Parse `fileName` into unique `vertices` and the `indices` of its triangles, optionally ordered
+            for the vertex cache.
+        */
+        bool load(const char* fileName, std::vector<float>& vertices, std::vector<uint32_t>& indices, bool shouldOptimizeVertexCache) {
+            std::vector<float> soup;
+            if (!load(fileName, soup))
+                return false;
+
+            MeshIndexer::index(soup, 8, vertices, indices);
+            if (shouldOptimizeVertexCache) {
+                MeshIndexer::optimizeVertexCache(vertices, 8, indices);
+            }
+            return true;
+        }
+};
+
+#endif
@@ -2,11 +2,15 @@
 #define OBJECT_HPP
 
 #include "./Model.hpp"
+#include "./RenderQueue.hpp"
+#include "./StaticBatch.hpp"
+#include "./KeyStates.hpp"
 #include <vector>
 
 class Object {
     protected:
         std::vector<Model*> _models;
+        bool _isBatched = false; //the models are drawn by a `StaticBatch` instead of being submitted
         
     public:
         float pos[3] = {0, 0, 0};
@@ -17,16 +21,47 @@ class Object {
             }
         }
 
-        virtual void draw() {
-            glPushMatrix();
-            glTranslatef(pos[0], pos[1], pos[2]);
+        /*
+            Hand the models to `batch` to be merged with the rest of the static scene, they're no longer
+            submitted on their own afterwards.
+        */
+        virtual void addStatic(StaticBatch& batch) {
             for (size_t i = 0; i < _models.size(); i++) {
-                _models.at(i)->draw();
+                batch.add(_models.at(i), pos, true);
             }
-            glPopMatrix();
+            _isBatched = true;
         }
 
-        virtual void update(double deltaTime, std::vector<int> noteStatuses) {}
+        /*
+            Queue the models to be drawn, lit, at the object's position.
+        */
+        virtual void submit(RenderQueue& queue) {
+            if (_isBatched)
+                return;
+
+            for (size_t i = 0; i < _models.size(); i++) {
+                queue.submit(_models.at(i), pos, true);
+            }
+        }
+
+        /*
+            Draw anything that doesn't go through the render queue, called after the queue is drawn.
+        */
+        virtual void draw() {}
+
+        /*
+            Send the models to the gpu ahead of their first draw, needs the gl context.
+        */
+        virtual void upload() {
+            for (size_t i = 0; i < _models.size(); i++) {
+                _models.at(i)->upload();
+            }
+        }
+
+        /*
+            Called once a frame with what the piano's keys are doing, shared by every object.
+        */
+        virtual void update(double deltaTime, const KeyStates& keyStates) {}
 };
 
 #endif
\ No newline at end of file
@@ -7,18 +7,27 @@
 
 #include "./Model.hpp"
 #include "./ModelFactory.hpp"
+#include "./Shader.hpp"
+#include "./ShaderLibrary.hpp"
 #include "../helpers/globals.h"
 
 #include <vector>
 #include <array>
 #include <string>
+#include <string_view>
 
 class Piano : public Object {
     private:
         std::vector<std::array<float, 6>> _strings;
         float _blackKeyWidth;
         float _whiteKeyWidth;
-        std::vector<int> _noteStatuses;
+        StaticBatch* _batch = nullptr;
+        std::vector<size_t> _keyParts; //where each key ended up in `_batch`
+        std::vector<bool> _isKeyPressed;
+        const float _keyPressDepth = 0.09f;
+        const int _lowestMidiNote = 33; //midi note number of the first key in the layout, A1
+        unsigned int _stringBuffer = 0;
+        unsigned int _stringArray = 0;
 
         std::vector<std::string> _pianoLayout = {
             "A1", "A#1", "B1",
@@ -30,6 +39,36 @@ class Piano : public Object {
             "C7", "C#7", "D7"
         };
 
+        /*
+            Put the strings in a vertex array for the shaders, as lines with the same vertex layout as
+            models. Their normals face +z, the default normal they were lit with before shaders.
+        */
+        void uploadStrings() {
+            if (_stringArray != 0)
+                return;
+
+            std::vector<float> vertices;
+            for (size_t i = 0; i < _strings.size(); i++) {
+                for (int end = 0; end < 2; end++) {
+                    const float* point = &_strings.at(i)[end * 3];
+                    vertices.insert(vertices.end(), {point[0], point[1], point[2], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f});
+                }
+            }
+
+            glGenVertexArrays(1, &_stringArray);
+            glGenBuffers(1, &_stringBuffer);
+            glBindVertexArray(_stringArray);
+            glBindBuffer(GL_ARRAY_BUFFER, _stringBuffer);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+            const GLsizei strideBytes = 8 * sizeof(float);
+            glEnableVertexAttribArray(ShaderLibrary::POSITION_ATTRIBUTE);
+            glEnableVertexAttribArray(ShaderLibrary::NORMAL_ATTRIBUTE);
+            glVertexAttribPointer(ShaderLibrary::POSITION_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, strideBytes, (void*)0);
+            glVertexAttribPointer(ShaderLibrary::NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, strideBytes, (void*)(5 * sizeof(float)));
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
     public:
         Piano() {
             std::vector<float> stringLengths = {
@@ -94,11 +133,58 @@ class Piano : public Object {
             _models.push_back(shellModel);
         }
 
-        void update(double deltaTime, std::vector<int> noteStatuses) override {
-            _noteStatuses = noteStatuses;
+        ~Piano() {
+            if (_stringArray != 0) {
+                glDeleteVertexArrays(1, &_stringArray);
+                glDeleteBuffers(1, &_stringBuffer);
+            }
+        }
+
+        void addStatic(StaticBatch& batch) override {
+            _batch = &batch;
+            _keyParts.clear();
+            for (size_t i = 0; i < _models.size(); i++) {
+                size_t part = batch.add(_models.at(i), pos, true);
+                if (i < _pianoLayout.size()) {
+                    _keyParts.push_back(part);
+                }
+            }
+            _isKeyPressed.assign(_keyParts.size(), false);
+            _isBatched = true;
         }
 
+        void update(double deltaTime, const KeyStates& keyStates) override {
+            //sounding keys are pushed down, only keys that change are touched
+            if (_batch == nullptr)
+                return;
+            for (size_t i = 0; i < _keyParts.size() && i < keyStates.size(); i++) {
+                bool isPressed = keyStates.isActive(i);
+                if (isPressed != _isKeyPressed.at(i)) {
+                    _isKeyPressed.at(i) = isPressed;
+                    float offset[3] = {0.0f, isPressed ? -_keyPressDepth : 0.0f, 0.0f};
+                    _batch->setPartOffset(_keyParts.at(i), offset);
+                }
+            }
+        }
+
+        /*
+            The keys and shell go through the render queue, only the strings are drawn here.
+        */
         void draw() override {
+            if (gShaders.isReady()) {
+                uploadStrings();
+                Shader* shader = gShaders.get("scene");
+                shader->use();
+                shader->setUniform("isLit", 1);
+                shader->setUniform("isTextured", 0);
+                shader->setUniform3("translation", pos);
+                glBindVertexArray(_stringArray);
+                glDrawArrays(GL_LINES, 0, (GLsizei)(_strings.size() * 2));
+                glBindVertexArray(0);
+                shader->setUniform("isTextured", 1);
+                return;
+            }
+
             glPushMatrix();
             glTranslatef(pos[0], pos[1], pos[2]);
             
@@ -112,21 +198,10 @@ class Piano : public Object {
             glEnd();
             glEnable(GL_TEXTURE_2D);
 
-            for (size_t i = 0; i < _models.size(); i++) {
-                /*if (_noteStatuses.at(i) == 1) {
-                    glPushMatrix();
-                    glTranslatef(0.0f, -0.09f, 0.0f);
-                    _models.at(i)->draw();
-                     glPopMatrix();
-                } else {*/
-                    _models.at(i)->draw();
-                //}
-            }
-
             glPopMatrix();
         }
 
-        std::vector<std::string> getLayout() {
+        const std::vector<std::string>& getLayout() {
             return _pianoLayout;
         }
 
@@ -138,13 +213,59 @@ class Piano : public Object {
             return _whiteKeyWidth;
         }
 
-        float getKeyX(std::string noteName) {
-            for (size_t i = 0; i < _pianoLayout.size(); i++) {
-                if (_pianoLayout.at(i) == noteName) {
-                    return _models.at(i)->pos[0];
-                }
+        float getKeyX(int keyIndex) {
+            return _models.at(keyIndex)->pos[0];
+        }
+
+        bool isBlackKey(int keyIndex) {
+            return _pianoLayout.at(keyIndex).find('#') != std::string::npos;
+        }
+
+        /*
+            Find the key for a midi note number, -1 if the piano doesn't have it.
+        */
+        int getKeyIndex(int midiNote) {
+            int keyIndex = midiNote - _lowestMidiNote;
+            if (keyIndex < 0 || keyIndex >= (int)_pianoLayout.size())
+                return -1;
+            return keyIndex;
+        }
+
+        int getMidiNote(int keyIndex) {
+            return keyIndex + _lowestMidiNote;
+        }
+
+        /*
+            Find the key for a note name like "C#4" or "B-3" ('-' and 'b' are flats), -1 if the name
+            can't be read or the piano doesn't have it.
+        */
+        int getKeyIndex(std::string_view noteName) {
+            //semitones above C for the letters A to G
+            static const int letterSemitones[7] = {9, 11, 0, 2, 4, 5, 7};
+
+            if (noteName.size() < 2 || noteName[0] < 'A' || noteName[0] > 'G')
+                return -1;
+            int semitone = letterSemitones[noteName[0] - 'A'];
+
+            size_t i = 1;
+            if (noteName[i] == '#') {
+                semitone += 1;
+                i++;
+            } else if (noteName[i] == '-' || noteName[i] == 'b') {
+                semitone -= 1;
+                i++;
+            }
+
+            int octave = 0;
+            if (i == noteName.size())
+                return -1;
+            for (; i < noteName.size(); i++) {
+                if (noteName[i] < '0' || noteName[i] > '9')
+                    return -1;
+                octave = octave * 10 + (noteName[i] - '0');
             }
-            return -99.9f;
+
+            return getKeyIndex(12 * (octave + 1) + semitone);
         }
 
 };
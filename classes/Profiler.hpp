@@ -0,0 +1,313 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdint>
+
+/*
+    Times named stages of each frame on the cpu, and on the gpu with timestamp queries where the driver
+    has them. The last few hundred samples of every stage are kept for percentiles, and with tracing on
+    every sample is kept to be written out as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+    Stages are timed with `ProfileScope`, which costs one branch while the profiler is off.
+*/
+class Profiler {
+    //the most recent samples of a stage, in milliseconds
+    struct Samples {
+        std::vector<float> values;
+        size_t next = 0;
+
+        void add(float value, size_t capacity) {
+            if (values.size() < capacity) {
+                values.push_back(value);
+            } else {
+                values[next] = value;
+            }
+            next = (next + 1) % capacity;
+        }
+    };
+
+    struct Stage {
+        const char* name;
+        Samples cpu;
+        Samples gpu;
+    };
+
+    struct TraceEvent {
+        size_t stage;
+        bool isGpu;
+        double start; //microseconds since the profiler was enabled
+        double duration;
+    };
+
+    //a stage timed on the gpu, by the timestamp queries at its ends
+    struct GpuScope {
+        size_t stage;
+        size_t beginQuery;
+        size_t endQuery;
+    };
+
+    //the queries issued during one frame, read back `_gpuLatency` frames later so reading doesn't stall
+    struct GpuFrame {
+        std::vector<unsigned int> queries;
+        size_t usedQueries = 0;
+        std::vector<GpuScope> scopes;
+    };
+
+    private:
+        static const size_t _sampleCapacity = 600; //ten seconds at 60 fps
+        static const size_t _gpuLatency = 4;
+
+        bool _isEnabled = false;
+        bool _isTracing = false;
+        bool _hasGpuTimer = false;
+        std::vector<Stage> _stages;
+        std::vector<TraceEvent> _trace;
+
+        std::chrono::steady_clock::time_point _startTime;
+        int64_t _gpuStartTime = 0; //gpu clock at `_startTime`, in nanoseconds
+        GpuFrame _gpuFrames[_gpuLatency];
+        size_t _frameIndex = 0;
+
+        size_t findStage(const char* name) {
+            for (size_t i = 0; i < _stages.size(); i++) {
+                if (_stages[i].name == name || std::strcmp(_stages[i].name, name) == 0)
+                    return i;
+            }
+            _stages.push_back(Stage());
+            _stages.back().name = name;
+            _stages.back().cpu.values.reserve(_sampleCapacity);
+            _stages.back().gpu.values.reserve(_sampleCapacity);
+            return _stages.size() - 1;
+        }
+
+        unsigned int nextQuery(GpuFrame& frame) {
+            if (frame.usedQueries == frame.queries.size()) {
+                unsigned int query;
+                glGenQueries(1, &query);
+                frame.queries.push_back(query);
+            }
+            return frame.queries[frame.usedQueries++];
+        }
+
+        /*
+            Read the results of a frame's queries, waiting for them if the gpu is that far behind.
+        */
+        void resolveGpuFrame(GpuFrame& frame) {
+            for (size_t i = 0; i < frame.scopes.size(); i++) {
+                const GpuScope& scope = frame.scopes[i];
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(frame.queries[scope.beginQuery], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(frame.queries[scope.endQuery], GL_QUERY_RESULT, &end);
+
+                double duration = (double)(end - begin) / 1000.0;
+                _stages[scope.stage].gpu.add((float)(duration / 1000.0), _sampleCapacity);
+                if (_isTracing) {
+                    double start = (double)((int64_t)begin - _gpuStartTime) / 1000.0;
+                    _trace.push_back({scope.stage, true, start, duration});
+                }
+            }
+            frame.scopes.clear();
+            frame.usedQueries = 0;
+        }
+
+        static float percentile(std::vector<float>& values, double fraction) {
+            if (values.empty())
+                return 0.0f;
+            size_t index = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+            std::nth_element(values.begin(), values.begin() + index, values.end());
+            return values[index];
+        }
+
+    public:
+        //what `beginScope()` hands back for `endScope()`
+        struct Scope {
+            size_t stage;
+            std::chrono::steady_clock::time_point start;
+            size_t beginQuery;
+        };
+
+    private:
+        Scope _frameScope; //the whole frame, from `beginFrame()` to `endFrame()`
+        bool _isInFrame = false;
+
+        void addCpuSample(size_t stage, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+            double duration = std::chrono::duration<double, std::micro>(end - start).count();
+            _stages[stage].cpu.add((float)(duration / 1000.0), _sampleCapacity);
+            if (_isTracing) {
+                _trace.push_back({stage, false, std::chrono::duration<double, std::micro>(start - _startTime).count(), duration});
+            }
+        }
+
+    public:
+        /*
+            Start profiling, needs the gl context. `isTracing` keeps every sample for `writeTrace()`.
+        */
+        void enable(bool isTracing) {
+            _isEnabled = true;
+            _isTracing = isTracing;
+            _hasGpuTimer = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+            _startTime = std::chrono::steady_clock::now();
+            if (_hasGpuTimer) {
+                GLint64 gpuTime = 0;
+                glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+                _gpuStartTime = gpuTime;
+            }
+        }
+
+        bool isEnabled() {
+            return _isEnabled;
+        }
+
+        /*
+            Start timing a frame as the stage "frame", everything up to `endFrame()` counts towards it.
+            The queries of an earlier frame are read back first, under "gpuReadback", since that can
+            wait on the gpu.
+        */
+        void beginFrame() {
+            if (!_isEnabled)
+                return;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            findStage("frame"); //listed first in the summary
+            if (_hasGpuTimer) {
+                resolveGpuFrame(_gpuFrames[_frameIndex % _gpuLatency]);
+                addCpuSample(findStage("gpuReadback"), start, std::chrono::steady_clock::now());
+            }
+            _frameScope = beginScope("frame");
+            _frameScope.start = start;
+            _isInFrame = true;
+        }
+
+        void endFrame() {
+            if (_isInFrame) {
+                endScope(_frameScope);
+                _isInFrame = false;
+            }
+            _frameIndex++;
+        }
+
+        Scope beginScope(const char* name) {
+            Scope scope;
+            scope.stage = findStage(name);
+            scope.beginQuery = 0;
+            if (_hasGpuTimer) {
+                GpuFrame& frame = _gpuFrames[_frameIndex % _gpuLatency];
+                scope.beginQuery = frame.usedQueries;
+                glQueryCounter(nextQuery(frame), GL_TIMESTAMP);
+            }
+            scope.start = std::chrono::steady_clock::now();
+            return scope;
+        }
+
+        void endScope(const Scope& scope) {
+            addCpuSample(scope.stage, scope.start, std::chrono::steady_clock::now());
+
+            if (_hasGpuTimer) {
+                GpuFrame& frame = _gpuFrames[_frameIndex % _gpuLatency];
+                size_t endQuery = frame.usedQueries;
+                glQueryCounter(nextQuery(frame), GL_TIMESTAMP);
+                frame.scopes.push_back({scope.stage, scope.beginQuery, endQuery});
+            }
+        }
+
+        /*
+            Read back every query still in flight and delete them, needs the gl context.
+        */
+        void finish() {
+            if (!_isEnabled || !_hasGpuTimer)
+                return;
+            for (size_t i = 0; i < _gpuLatency; i++) {
+                GpuFrame& frame = _gpuFrames[(_frameIndex + i) % _gpuLatency];
+                resolveGpuFrame(frame);
+                if (!frame.queries.empty()) {
+                    glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+                    frame.queries.clear();
+                }
+            }
+            _hasGpuTimer = false;
+        }
+
+        /*
+            Print the 50th, 95th and 99th percentile of every stage over the recent frames.
+        */
+        void printSummary(std::ostream& out) {
+            out << std::left << std::setw(16) << "stage (ms)" << std::right
+                << std::setw(9) << "cpu p50" << std::setw(9) << "p95" << std::setw(9) << "p99"
+                << std::setw(9) << "gpu p50" << std::setw(9) << "p95" << std::setw(9) << "p99" << std::endl;
+            out << std::fixed << std::setprecision(3);
+            for (size_t i = 0; i < _stages.size(); i++) {
+                std::vector<float> cpu = _stages[i].cpu.values;
+                std::vector<float> gpu = _stages[i].gpu.values;
+                out << std::left << std::setw(16) << _stages[i].name << std::right
+                    << std::setw(9) << percentile(cpu, 0.5) << std::setw(9) << percentile(cpu, 0.95) << std::setw(9) << percentile(cpu, 0.99);
+                if (!gpu.empty()) {
+                    out << std::setw(9) << percentile(gpu, 0.5) << std::setw(9) << percentile(gpu, 0.95) << std::setw(9) << percentile(gpu, 0.99);
+                }
+                out << std::endl;
+            }
+            out << std::defaultfloat << std::setprecision(6);
+        }
+
+        /*
+            Write every recorded sample as a Chrome trace, cpu and gpu stages on tracks of their own.
+        */
+        bool writeTrace(const char* fileName) {
+            std::ofstream file(fileName);
+            if (!file.is_open()) {
+                std::cout << "Could not open " << fileName << " for writing." << std::endl;
+                return false;
+            }
+
+            file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}}," << std::endl;
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"gpu\"}}";
+            file << std::fixed << std::setprecision(3);
+            for (size_t i = 0; i < _trace.size(); i++) {
+                const TraceEvent& event = _trace[i];
+                file << "," << std::endl << "{\"name\":\"" << _stages[event.stage].name << "\",\"cat\":\""
+                    << (event.isGpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.isGpu ? 2 : 1)
+                    << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+            }
+            file << std::endl << "]}" << std::endl;
+            return file.good();
+        }
+};
+
+/*
+    Times the rest of the enclosing block as the stage `name`, which should be a string literal.
+*/
+class ProfileScope {
+    private:
+        Profiler& _profiler;
+        Profiler::Scope _scope;
+        bool _isActive;
+
+    public:
+        ProfileScope(Profiler& profiler, const char* name) : _profiler(profiler), _isActive(profiler.isEnabled()) {
+            if (_isActive) {
+                _scope = _profiler.beginScope(name);
+            }
+        }
+
+        ~ProfileScope() {
+            if (_isActive) {
+                _profiler.endScope(_scope);
+            }
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#endif
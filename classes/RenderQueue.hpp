@@ -0,0 +1,113 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include "../helpers/openGlHelpers.cpp"
+#include "./Model.hpp"
+#include "./Shader.hpp"
+#include "./ShaderLibrary.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+/*
+    Collects the models to draw in a frame and draws them sorted by the state they need, so lighting is
+    switched and textures and vertex arrays are bound once per run of models sharing them rather than
+    once per model.
+*/
+class RenderQueue {
+    struct DrawItem {
+        uint64_t key; //lighting, then texture, then vertex array
+        uint32_t order; //submission order, keeps the sort deterministic
+        Model* model;
+        float pos[3];
+        bool isLit;
+    };
+
+    private:
+        std::vector<DrawItem> _items; //kept between frames so submitting doesn't allocate once it's grown
+
+    public:
+        void clear() {
+            _items.clear();
+        }
+
+        /*
+            Queue `model` to be drawn at `offset` plus its own position.
+        */
+        void submit(Model* model, const float offset[3], bool isLit) {
+            DrawItem item;
+            item.model = model;
+            item.isLit = isLit;
+            item.order = (uint32_t)_items.size();
+            for (int axis = 0; axis < 3; axis++) {
+                item.pos[axis] = offset[axis] + model->pos[axis];
+            }
+
+            //unlit models go last, they're the ones that switch lighting off
+            item.key = ((uint64_t)(isLit ? 0 : 1) << 63)
+                | ((uint64_t)(model->getTexture() & 0x7FFFFFFF) << 32)
+                | model->getVertexArray();
+            _items.push_back(item);
+        }
+
+        /*
+            Draw everything queued, sorted by state. With shaders the scene program is left in use,
+            without them lighting is left enabled.
+        */
+        void draw() {
+            std::sort(_items.begin(), _items.end(), [](const DrawItem& a, const DrawItem& b) {
+                return a.key != b.key ? a.key < b.key : a.order < b.order;
+            });
+
+            Shader* shader = gShaders.isReady() ? gShaders.get("scene") : nullptr;
+            bool isLit = true;
+            if (shader != nullptr) {
+                shader->use();
+                shader->setUniform("isLit", 1);
+                shader->setUniform("isTextured", 1);
+            } else {
+                glEnable(GL_LIGHTING);
+            }
+
+            bool hasVertexArray = false;
+            for (size_t i = 0; i < _items.size(); i++) {
+                const DrawItem& item = _items[i];
+                if (item.isLit != isLit) {
+                    isLit = item.isLit;
+                    if (shader != nullptr) {
+                        shader->setUniform("isLit", isLit ? 1 : 0);
+                    } else {
+                        isLit ? glEnable(GL_LIGHTING) : glDisable(GL_LIGHTING);
+                    }
+                }
+                bindTexture(item.model->getTexture());
+
+                if (shader != nullptr) {
+                    shader->setUniform3("translation", item.pos);
+                    item.model->drawMesh();
+                } else {
+                    glPushMatrix();
+                    glTranslatef(item.pos[0], item.pos[1], item.pos[2]);
+                    item.model->drawMesh();
+                    glPopMatrix();
+                }
+                hasVertexArray = hasVertexArray || item.model->getVertexArray() != 0;
+            }
+
+            if (hasVertexArray) {
+                glBindVertexArray(0);
+            }
+            if (shader != nullptr) {
+                shader->setUniform("isLit", 1);
+            } else {
+                glEnable(GL_LIGHTING);
+            }
+        }
+};
+
+#endif
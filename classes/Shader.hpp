@@ -0,0 +1,117 @@
+#ifndef SHADER_HPP
+#define SHADER_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include "../helpers/openGlHelpers.cpp"
+
+#include <string>
+#include <unordered_map>
+
+/*
+    A linked shader program. Uniform locations are looked up once and remembered, and the camera and
+    light uniform blocks are attached to their fixed binding points so every program shares the same
+    buffers, see `ShaderLibrary`.
+*/
+class Shader {
+    private:
+        unsigned int _program = 0;
+        std::unordered_map<std::string, int> _uniformLocations;
+
+        static inline Shader* _current = nullptr;
+
+        void bindUniformBlock(const char* name, unsigned int binding) {
+            unsigned int index = glGetUniformBlockIndex(_program, name);
+            if (index != GL_INVALID_INDEX) {
+                glUniformBlockBinding(_program, index, binding);
+            }
+        }
+
+    public:
+        static const unsigned int CAMERA_BLOCK_BINDING = 0;
+        static const unsigned int LIGHT_BLOCK_BINDING = 1;
+
+        Shader(const char* vertexSource, const char* fragmentSource) {
+            _program = createShaderProgram(vertexSource, fragmentSource);
+            if (_program != 0) {
+                bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+                bindUniformBlock("Light", LIGHT_BLOCK_BINDING);
+            }
+        }
+
+        ~Shader() {
+            if (_current == this) {
+                useNone();
+            }
+            if (_program != 0) {
+                glDeleteProgram(_program);
+            }
+        }
+
+        Shader(const Shader&) = delete;
+        Shader& operator=(const Shader&) = delete;
+
+        bool isValid() {
+            return _program != 0;
+        }
+
+        /*
+            Make this the current program, skipping the call when it already is.
+        */
+        void use() {
+            if (_current != this) {
+                glUseProgram(_program);
+                _current = this;
+            }
+        }
+
+        /*
+            Go back to the fixed function pipeline.
+        */
+        static void useNone() {
+            if (_current != nullptr) {
+                glUseProgram(0);
+                _current = nullptr;
+            }
+        }
+
+        //the program in use, nullptr while drawing with the fixed function pipeline
+        static Shader* getCurrent() {
+            return _current;
+        }
+
+        int getUniformLocation(const char* name) {
+            auto found = _uniformLocations.find(name);
+            if (found != _uniformLocations.end())
+                return found->second;
+
+            int location = glGetUniformLocation(_program, name);
+            _uniformLocations.emplace(name, location);
+            return location;
+        }
+
+        int getAttributeLocation(const char* name) {
+            return glGetAttribLocation(_program, name);
+        }
+
+        //the setters apply to this program, which has to be the current one
+        void setUniform(const char* name, int value) {
+            glUniform1i(getUniformLocation(name), value);
+        }
+
+        void setUniform(const char* name, float value) {
+            glUniform1f(getUniformLocation(name), value);
+        }
+
+        void setUniform3(const char* name, const float value[3]) {
+            glUniform3fv(getUniformLocation(name), 1, value);
+        }
+
+        void setUniform4(const char* name, const float value[4]) {
+            glUniform4fv(getUniformLocation(name), 1, value);
+        }
+};
+
+#endif
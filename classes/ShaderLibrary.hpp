@@ -0,0 +1,277 @@
+#ifndef SHADER_LIBRARY_HPP
+#define SHADER_LIBRARY_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include "../helpers/openGlHelpers.cpp"
+#include "./Shader.hpp"
+
+#include <map>
+#include <string>
+#include <iostream>
+
+/*
+    Compiles the scene's shaders once and hands them out by name, and owns the uniform buffers for the
+    camera and the light that every program reads. The shaders only use what a 3.3 core profile has,
+    when they can't be built `isReady()` stays false and drawing falls back to the fixed function pipeline.
+*/
+class ShaderLibrary {
+    //std140 layouts of the uniform blocks in `_header`
+    struct CameraBlock {
+        float view[16];
+        float projection[16];
+        float position[4];
+    };
+
+    struct LightBlock {
+        float position[4];
+        float ambient[4];
+        float diffuse[4];
+    };
+
+    private:
+        std::map<std::string, Shader*> _shaders;
+        bool _isReady = false;
+        unsigned int _cameraBuffer = 0;
+        unsigned int _lightBuffer = 0;
+        unsigned int _rectangleArray = 0;
+        unsigned int _rectangleBuffer = 0;
+
+        //put in front of every stage, so all programs agree on the version and the shared blocks
+        const char* _header = R"(
+            #version 330 core
+            layout(std140) uniform Camera {
+                mat4 view;
+                mat4 projection;
+                vec4 position;
+            } camera;
+            layout(std140) uniform Light {
+                vec4 position; //world space
+                vec4 ambient;
+                vec4 diffuse;
+            } light;
+        )";
+
+        //textured models, lit per vertex the way GL_LIGHT0 lit them with the default material
+        const char* _sceneVertexSource = R"(
+            layout(location = 0) in vec3 vertexPosition;
+            layout(location = 1) in vec2 vertexTexcoord;
+            layout(location = 2) in vec3 vertexNormal;
+            uniform vec3 translation;
+            uniform bool isLit;
+            out vec2 texcoord;
+            out vec3 shade;
+
+            const float sceneAmbient = 0.2;
+            const float materialAmbient = 0.2;
+            const float materialDiffuse = 0.8;
+
+            void main() {
+                vec3 position = vertexPosition + translation;
+                gl_Position = camera.projection * camera.view * vec4(position, 1.0);
+                texcoord = vertexTexcoord;
+
+                shade = vec3(1.0);
+                if (isLit) {
+                    vec3 toLight = normalize(light.position.xyz - position);
+                    float diffuse = max(dot(normalize(vertexNormal), toLight), 0.0);
+                    shade = (sceneAmbient + light.ambient.rgb) * materialAmbient + light.diffuse.rgb * materialDiffuse * diffuse;
+                }
+            }
+        )";
+
+        const char* _sceneFragmentSource = R"(
+            uniform sampler2D diffuseTexture;
+            uniform bool isTextured;
+            in vec2 texcoord;
+            in vec3 shade;
+            out vec4 fragColor;
+
+            void main() {
+                vec4 color = isTextured ? texture(diffuseTexture, texcoord) : vec4(1.0);
+                fragColor = color * vec4(shade, 1.0);
+            }
+        )";
+
+        //solid colour in normalized device coordinates, for overlays
+        const char* _flatVertexSource = R"(
+            layout(location = 0) in vec2 vertexPosition;
+
+            void main() {
+                gl_Position = vec4(vertexPosition, 0.0, 1.0);
+            }
+        )";
+
+        const char* _flatFragmentSource = R"(
+            uniform vec4 color;
+            out vec4 fragColor;
+
+            void main() {
+                fragColor = color;
+            }
+        )";
+
+        unsigned int createUniformBuffer(size_t size, unsigned int binding) {
+            unsigned int buffer;
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+            return buffer;
+        }
+
+    public:
+        //where models put their vertex attributes, fixed by the `layout` qualifiers above
+        static const unsigned int POSITION_ATTRIBUTE = 0;
+        static const unsigned int TEXCOORD_ATTRIBUTE = 1;
+        static const unsigned int NORMAL_ATTRIBUTE = 2;
+
+        ~ShaderLibrary() {
+            clear();
+        }
+
+        static bool isSupported() {
+            return GLEW_VERSION_3_3;
+        }
+
+        /*
+            Build the built in programs and the uniform buffers, needs the gl context. Returns false, and
+            leaves the library unready, when the driver can't run them.
+        */
+        bool init() {
+            if (!isSupported())
+                return false;
+
+            if (load("scene", _sceneVertexSource, _sceneFragmentSource) == nullptr || load("flat", _flatVertexSource, _flatFragmentSource) == nullptr) {
+                std::cout << "Falling back to fixed function drawing." << std::endl;
+                clear();
+                return false;
+            }
+
+            _cameraBuffer = createUniformBuffer(sizeof(CameraBlock), Shader::CAMERA_BLOCK_BINDING);
+            _lightBuffer = createUniformBuffer(sizeof(LightBlock), Shader::LIGHT_BLOCK_BINDING);
+            _isReady = true;
+            return true;
+        }
+
+        //true once `init()` has succeeded, until `clear()`
+        bool isReady() {
+            return _isReady;
+        }
+
+        /*
+            Compile and link a program from the bodies of its stages, which get the shared header put in
+            front of them. Programs are built once per name, later calls return the same one. Returns
+            nullptr if the program doesn't build.
+        */
+        Shader* load(const char* name, const char* vertexSource, const char* fragmentSource) {
+            auto found = _shaders.find(name);
+            if (found != _shaders.end())
+                return found->second;
+
+            std::string vertex = std::string(_header) + vertexSource;
+            std::string fragment = std::string(_header) + fragmentSource;
+            Shader* shader = new Shader(vertex.c_str(), fragment.c_str());
+            if (!shader->isValid()) {
+                std::cout << "Could not build the " << name << " shader." << std::endl;
+                delete shader;
+                return nullptr;
+            }
+
+            _shaders.emplace(name, shader);
+            return shader;
+        }
+
+        //a program made by `load()`, nullptr if there isn't one by that name
+        Shader* get(const char* name) {
+            auto found = _shaders.find(name);
+            return found == _shaders.end() ? nullptr : found->second;
+        }
+
+        void setCamera(const float view[16], const float projection[16], const float position[3]) {
+            CameraBlock block;
+            for (int i = 0; i < 16; i++) {
+                block.view[i] = view[i];
+                block.projection[i] = projection[i];
+            }
+            block.position[0] = position[0];
+            block.position[1] = position[1];
+            block.position[2] = position[2];
+            block.position[3] = 1.0f;
+
+            glBindBuffer(GL_UNIFORM_BUFFER, _cameraBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        void setLight(const float position[4], const float ambient[4], const float diffuse[4]) {
+            LightBlock block;
+            for (int i = 0; i < 4; i++) {
+                block.position[i] = position[i];
+                block.ambient[i] = ambient[i];
+                block.diffuse[i] = diffuse[i];
+            }
+
+            glBindBuffer(GL_UNIFORM_BUFFER, _lightBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightBlock), &block);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        /*
+            Fill a rectangle given in normalized device coordinates with a solid colour, using the flat
+            program.
+        */
+        void drawRectangle(float left, float bottom, float right, float top, const float color[4]) {
+            if (_rectangleArray == 0) {
+                glGenVertexArrays(1, &_rectangleArray);
+                glGenBuffers(1, &_rectangleBuffer);
+                glBindVertexArray(_rectangleArray);
+                glBindBuffer(GL_ARRAY_BUFFER, _rectangleBuffer);
+                glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(float), nullptr, GL_STREAM_DRAW);
+                glEnableVertexAttribArray(POSITION_ATTRIBUTE);
+                glVertexAttribPointer(POSITION_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+            } else {
+                glBindVertexArray(_rectangleArray);
+                glBindBuffer(GL_ARRAY_BUFFER, _rectangleBuffer);
+            }
+
+            const float corners[8] = {left, bottom, right, bottom, right, top, left, top};
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(corners), corners);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            Shader* flat = get("flat");
+            flat->use();
+            flat->setUniform4("color", color);
+            glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+            glBindVertexArray(0);
+        }
+
+        /*
+            Delete the programs and buffers, needs the gl context.
+        */
+        void clear() {
+            for (auto& shader : _shaders) {
+                delete shader.second;
+            }
+            _shaders.clear();
+
+            if (_cameraBuffer != 0) {
+                glDeleteBuffers(1, &_cameraBuffer);
+                glDeleteBuffers(1, &_lightBuffer);
+                _cameraBuffer = 0;
+                _lightBuffer = 0;
+            }
+            if (_rectangleArray != 0) {
+                glDeleteVertexArrays(1, &_rectangleArray);
+                glDeleteBuffers(1, &_rectangleBuffer);
+                _rectangleArray = 0;
+                _rectangleBuffer = 0;
+            }
+            _isReady = false;
+        }
+};
+
+#endif
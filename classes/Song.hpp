@@ -7,146 +7,453 @@
 
 #include "../helpers/openGlHelpers.cpp"
 #include "../helpers/globals.h"
-#include "./Model.hpp"
 #include "./Piano.hpp"
+#include "./NoteRenderer.hpp"
+#include "./KeyStates.hpp"
+#include "./ActiveNotes.hpp"
+#include "./TempoMap.hpp"
+#include "./MidiFile.hpp"
+#include "./MappedFile.hpp"
+#include "./FileStamp.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <filesystem>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
 
 class Song {
-    struct Note {
-        Model* model;
-        int noteIndex;
-        double startTime;
-        double endTime;
-        float color[3];
+    //a note as it's kept in memory and in the song cache, so a cache file can be used in place and
+    //uploaded straight to the gpu
+    using Note = NoteRenderer::Note;
+    using KeyPlacement = NoteRenderer::KeyPlacement;
+
+    using TempoChange = TempoMap::TempoChange;
+
+    //start of a song cache file, followed by `noteCount` notes sorted by start time and then the
+    //`tempoCount` tempo changes, all little endian
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t keyCount;
+        uint32_t noteSize;
+        FileStamp source;
+        double songLength;
+        double maxDuration;
+        uint64_t noteCount;
+        uint64_t tempoCount;
     };
 
     private:
+        //notes are read through `_noteTable`, which points either into `_notes` or into a mapped cache file
         std::vector<Note> _notes;
-        std::vector<int> _noteStatuses;
-        double _songProgress = 0.0f;
+        const Note* _noteTable = nullptr;
+        size_t _noteCount = 0;
+        MappedFile* _cacheFile = nullptr;
+        const uint32_t _cacheVersion = 2;
+
+        std::vector<KeyPlacement> _keys;
+        NoteRenderer* _noteRenderer = nullptr;
+        bool _isUploaded = false; //whether `_noteRenderer` has the current notes
+        KeyStates _keyStates;
+        ActiveNotes _activeNotes; //fills in `_keyStates` as the song plays
+        double _songProgress = 0.0f; //in beats
+        double _songTime = 0.0; //the same point in seconds, which is what time moves forward in
+        double _songLength = 0.0;
+        TempoMap _tempoMap;
+
+        //`_noteTable` is sorted by start time, the notes in [_windowBegin, _windowEnd) are the only ones
+        //that can be on screen: nothing before `_windowBegin` can still be sounding given the longest
+        //note in the song, and nothing after `_windowEnd` has come into view yet
+        size_t _windowBegin = 0;
+        size_t _windowEnd = 0;
+        double _maxDuration = 0.0;
+        const double _lookAhead = 20.0 - 3.18;
+
+        /*
+            Split off everything before the next `delimiter`, `text` is left with what comes after it.
+        */
+        static std::string_view nextToken(std::string_view& text, char delimiter) {
+            size_t end = text.find(delimiter);
+            std::string_view token = text.substr(0, end);
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+            return token;
+        }
+
+        static bool parseNumber(std::string_view text, double& value) {
+            const char* end = text.data() + text.size();
+            std::from_chars_result result = std::from_chars(text.data(), end, value);
+            return result.ec == std::errc() && result.ptr == end;
+        }
+
+        static bool parseDuration(std::string_view text, double& duration) {
+            size_t slash = text.find('/');
+            if (slash == std::string_view::npos)
+                return parseNumber(text, duration);
+
+            double numerator, denominator;
+            if (!parseNumber(text.substr(0, slash), numerator) || !parseNumber(text.substr(slash + 1), denominator) || denominator == 0.0)
+                return false;
+            duration = numerator / denominator;
+            return true;
+        }
+
+        void addNote(int keyIndex, double startTime, double duration, int velocity) {
+            if (keyIndex < 0 || keyIndex >= (int)_keys.size())
+                return;
+
+            Note newNote;
+            newNote.keyIndex = keyIndex;
+            newNote.velocity = velocity;
+            newNote.startTime = startTime;
+            newNote.duration = duration;
+            NoteRenderer::colorNote(newNote, _keys);
+
+            _notes.push_back(newNote);
+            _maxDuration = std::max(_maxDuration, (double)newNote.duration);
+            _songLength = std::max(_songLength, startTime + duration + 0.5); //let the last note ring for half a beat
+        }
+
+        /*
+            Called before notes are added, records where each of the piano's keys is.
+        */
+        void beginLoading(Piano* piano) {
+            _keys = NoteRenderer::placeKeys(piano);
+            _keyStates.setKeyCount(_keys.size());
+
+            //notes from a cache file are read only, copy them out so more can be added
+            if (_cacheFile != nullptr) {
+                _notes.assign(_noteTable, _noteTable + _noteCount);
+                _noteTable = _notes.data();
+                _isUploaded = false;
+                delete _cacheFile;
+                _cacheFile = nullptr;
+            }
+        }
+
+        /*
+            Called once all of the notes are added, sorts them for the playhead window.
+        */
+        void finishLoading() {
+            std::stable_sort(_notes.begin(), _notes.end(), [](const Note& a, const Note& b) {
+                return a.startTime < b.startTime;
+            });
+            _noteTable = _notes.data();
+            _noteCount = _notes.size();
+            _isUploaded = false;
+            _tempoMap.build();
+            _activeNotes.setNotes(_noteTable, _noteCount, _maxDuration);
+            seek(_songProgress);
+        }
+
+        /*
+            Map a song cache and use its notes in place. `sourceName` is the file the cache was built
+            from, if it's given the cache is only used while it still matches that file.
+        */
+        bool loadCache(const char* cacheName, const char* sourceName) {
+            if (!FileStamp::isLittleEndian())
+                return false;
 
-        std::string standardizeNoteName(std::string noteName) {
-            if (noteName.substr(0, 2) == "B-") {
-                noteName[0] = 'A';
-                noteName[1] = '#';
-            } else if (noteName.substr(0, 2) == "E-") {
-                noteName[0] = 'D';
-                noteName[1] = '#';
+            MappedFile* file = new MappedFile(cacheName);
+            CacheHeader header;
+            bool isValid = file->isOpen() && file->size() >= sizeof(CacheHeader);
+            if (isValid) {
+                std::memcpy(&header, file->data(), sizeof(CacheHeader));
+                isValid = std::memcmp(header.magic, "MVSC", 4) == 0
+                    && header.version == _cacheVersion
+                    && header.keyCount == _keys.size()
+                    && header.noteSize == sizeof(Note)
+                    && header.noteCount < (file->size() / sizeof(Note))
+                    && header.tempoCount < (file->size() / sizeof(TempoChange))
+                    && file->size() == sizeof(CacheHeader) + header.noteCount * sizeof(Note) + header.tempoCount * sizeof(TempoChange);
+            }
+            if (isValid && sourceName != nullptr) {
+                isValid = header.source.matches(sourceName);
             }
+            if (!isValid) {
+                delete file;
+                return false;
+            }
+
+            _notes.clear();
+            _cacheFile = file;
+            _noteTable = (const Note*)(file->data() + sizeof(CacheHeader));
+            _noteCount = header.noteCount;
+            _songLength = header.songLength;
+            _maxDuration = header.maxDuration;
+            _isUploaded = false;
 
-            return noteName;
+            _tempoMap.clear();
+            const char* tempoData = file->data() + sizeof(CacheHeader) + _noteCount * sizeof(Note);
+            for (size_t i = 0; i < header.tempoCount; i++) {
+                TempoChange change;
+                std::memcpy(&change, tempoData + i * sizeof(TempoChange), sizeof(TempoChange));
+                _tempoMap.addChange(change.beat, change.beatsPerMinute);
+            }
+            _tempoMap.build();
+
+            _activeNotes.setNotes(_noteTable, _noteCount, _maxDuration);
+            seek(_songProgress);
+            return true;
         }
 
+        /*
+            Save the loaded notes next to their source so the next run can map them instead of parsing.
+            The cache is written to a temporary file first so a reader never sees half of one.
+        */
+        void writeCache(const char* cacheName, const char* sourceName) {
+            CacheHeader header = {};
+            if (!FileStamp::isLittleEndian() || !FileStamp::fromFile(sourceName, header.source))
+                return;
+
+            std::memcpy(header.magic, "MVSC", 4);
+            header.version = _cacheVersion;
+            header.keyCount = _keys.size();
+            header.noteSize = sizeof(Note);
+            header.songLength = _songLength;
+            header.maxDuration = _maxDuration;
+            header.noteCount = _noteCount;
+            header.tempoCount = _tempoMap.getChanges().size();
+
+            std::string temporaryName = std::string(cacheName) + ".tmp";
+            std::ofstream file(temporaryName, std::ios::binary);
+            file.write((const char*)&header, sizeof(CacheHeader));
+            file.write((const char*)_noteTable, _noteCount * sizeof(Note));
+            file.write((const char*)_tempoMap.getChanges().data(), header.tempoCount * sizeof(TempoChange));
+            file.close();
+
+            std::error_code error;
+            if (file.good()) {
+                std::filesystem::rename(temporaryName, cacheName, error);
+            } else {
+                std::filesystem::remove(temporaryName, error);
+            }
+        }
 
     public:
         ~Song() {
-            for (size_t i = 0; i < _notes.size(); i++) {
-                delete _notes.at(i).model;
+            delete _noteRenderer;
+            delete _cacheFile;
+        }
+
+        /*
+            Load notes from a standard midi file (.mid/.midi), a pre-converted csv or a song cache
+            (.mvsong), based on the extension. Midi and csv songs are cached in a .mvsong file next to
+            them, which later runs load instead while the source is unchanged.
+        */
+        void addNotesFromFile(const char* fileName, Piano* piano) {
+            std::string name = fileName;
+            size_t dot = name.find_last_of('.');
+            std::string extension = dot == std::string::npos ? "" : name.substr(dot + 1);
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+            if (extension == "mvsong") {
+                beginLoading(piano);
+                if (!loadCache(fileName, nullptr)) {
+                    gShouldExit = true;
+                    std::cout << "Could not load song cache " << fileName << "!" << std::endl;
+                }
+                return;
+            }
+
+            //only a song loaded on its own is cached, not one added on to other notes
+            std::string cacheName = name + ".mvsong";
+            bool isCacheable = _noteCount == 0;
+            if (isCacheable) {
+                beginLoading(piano);
+                if (loadCache(cacheName.c_str(), fileName))
+                    return;
+            }
+
+            if (extension == "mid" || extension == "midi") {
+                addNotesFromMidi(fileName, piano);
+            } else {
+                addNotesFromCsv(fileName, piano);
+            }
+
+            if (isCacheable && !gShouldExit) {
+                writeCache(cacheName.c_str(), fileName);
             }
         }
 
+        /*
+            Load notes from a csv with the columns `index,note_name,start_time,duration,velocity,tempo`.
+            The file is parsed in place, durations may be decimals or fractions like "49/100". The tempo
+            is the one in effect from the row's start time, times are in beats.
+        */
         void addNotesFromCsv(const char* fileName, Piano* piano) {
-            _noteStatuses.clear();
-            for (size_t i = 0; i < piano->getLayout().size(); i++) {
-                _noteStatuses.push_back(0);
-            }
+            beginLoading(piano);
 
-            std::ifstream file;
-            file.open(fileName);
-            if (!file.is_open()) {
+            MappedFile file(fileName);
+            if (!file.isOpen()) {
                 gShouldExit = true; //todo: this is no longer a safe exit condition, since this method is called after `buildScene`, new condition pls
                 std::cout << "Could not open " << fileName << "!" << std::endl;
                 return;
             }
 
-            std::string line;
-            std::vector<std::string> tokens;
-            std::getline(file, line);
-            while (std::getline(file, line)) {
-                tokens = split(line, ",");
-                std::string noteName = standardizeNoteName(tokens.at(1));
-                std::string strStartTime = tokens.at(2);
-                std::string strDuration = tokens.at(3);
-                double startTime = std::stod(strStartTime);
-                double duration;
-
-                std::vector<std::string> durationDescription = split(strDuration, "/");
-                if (durationDescription.size() > 1) {
-                    duration = std::stod(durationDescription.at(0)) / std::stod(durationDescription.at(1));
-                } else {
-                    duration = std::stod(strDuration);
+            std::string_view text(file.data(), file.size());
+            _notes.reserve(_notes.size() + std::count(text.begin(), text.end(), '\n'));
+
+            size_t lineNumber = 0;
+            size_t skippedLines = 0;
+            double lastTempo = 0.0;
+            while (!text.empty()) {
+                std::string_view line = nextToken(text, '\n');
+                lineNumber++;
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
                 }
+                if (lineNumber == 1 || line.empty())
+                    continue; //header
+
+                nextToken(line, ','); //index
+                std::string_view noteName = nextToken(line, ',');
+                std::string_view strStartTime = nextToken(line, ',');
+                std::string_view strDuration = nextToken(line, ',');
+                std::string_view strVelocity = nextToken(line, ',');
+                std::string_view strTempo = nextToken(line, ',');
 
-                float noteWidth = piano->getWhiteKeyWidth();
-                float noteOffsetZ = 1.6f;
-                float brightness = 1.15f;
-                if (noteName.find('#') != std::string::npos) {
-                    noteWidth = piano->getBlackKeyWidth();
-                    noteOffsetZ -= 0.45f;
-                    brightness = 0.8f;
+                double startTime, duration, velocity;
+                if (!parseNumber(strStartTime, startTime) || !parseDuration(strDuration, duration) || !parseNumber(strVelocity, velocity)) {
+                    skippedLines++;
+                    continue;
                 }
 
-                Note newNote;
-                Model* noteModel = ModelFactory::fromNote(noteWidth, duration, noteWidth * 0.75f);
-                noteModel->setTextureHandle(gTextureHandles::NOTE);
-                noteModel->pos[0] = piano->getKeyX(noteName);
-                noteModel->pos[1] = startTime + 3.18f;
-                noteModel->pos[2] = noteOffsetZ;
+                //every row repeats the tempo, only a change of it is kept
+                double tempo;
+                if (parseNumber(strTempo, tempo) && tempo != lastTempo) {
+                    _tempoMap.addChange(startTime, tempo);
+                    lastTempo = tempo;
+                }
 
-                float r = ((float)indexOf(piano->getLayout(), noteName) / (float)piano->getLayout().size());
-                float g = 0.2f;
-                float b = 1.0f - r;
-                newNote.color[0] = r * brightness;
-                newNote.color[1] = g * brightness;
-                newNote.color[2] = b * brightness;
+                addNote(piano->getKeyIndex(noteName), startTime, duration, (int)velocity);
+            }
 
-                newNote.model = noteModel;
-                newNote.noteIndex = indexOf(piano->getLayout(), noteName);
-                newNote.startTime = startTime;
-                newNote.endTime = startTime + duration;
+            if (skippedLines > 0) {
+                std::cout << "Skipped " << skippedLines << " malformed lines in " << fileName << "." << std::endl;
+            }
 
-                _notes.push_back(newNote);
+            finishLoading();
+        }
+
+        void addNotesFromMidi(const char* fileName, Piano* piano) {
+            beginLoading(piano);
+
+            MidiFile midiFile;
+            if (!midiFile.load(fileName)) {
+                gShouldExit = true;
+                return;
+            }
+
+            const std::vector<MidiFile::Note>& notes = midiFile.getNotes();
+            _notes.reserve(_notes.size() + notes.size());
+            for (size_t i = 0; i < notes.size(); i++) {
+                const MidiFile::Note& note = notes[i];
+                addNote(piano->getKeyIndex(note.key), note.startTime, note.duration, note.velocity);
             }
-            
+
+            const std::vector<MidiFile::TempoChange>& tempoChanges = midiFile.getTempoChanges();
+            for (size_t i = 0; i < tempoChanges.size(); i++) {
+                _tempoMap.addChange(tempoChanges[i].startTime, tempoChanges[i].beatsPerMinute);
+            }
+
+            finishLoading();
         }
 
-        void draw() {
-            for (size_t i = 0; i < _notes.size(); i++) {
-                Note note = _notes.at(i);
-                if (note.model->pos[1] > 20.0f || note.model->pos[1] < -10.0f)
-                    continue;
-                
-                /*if (_noteStatuses.at(note.noteIndex) == 1) {
-                    note.model->drawNote(note.color[0] * 3.0f, note.color[1] * 3.0f, note.color[2] * 3.0f);
-                } else {*/
-                    note.model->drawNote(note.color[0], note.color[1], note.color[2]);
-                //}
+        /*
+            Create the gpu side of the note renderer and hand it the notes, needs the gl context. Loading
+            notes doesn't, so it can happen on any thread.
+        */
+        void upload() {
+            if (_noteRenderer == nullptr) {
+                _noteRenderer = new NoteRenderer();
             }
+            if (!_isUploaded) {
+                _noteRenderer->setKeys(_keys);
+                _noteRenderer->setNotes(_noteTable, _noteCount);
+                _isUploaded = true;
+            }
+        }
 
+        void draw() {
+            upload();
+            _noteRenderer->draw(_songProgress, _windowBegin, _windowEnd - _windowBegin, _keyStates);
         }
 
+        /*
+            Move the song on by `deltaTime` milliseconds, at whatever tempo it's at.
+        */
         void update(double deltaTime) {
-            _songProgress += (deltaTime / 1000.0) * (124.0 / 60.0);
-            if (_songProgress > 202.5f) {
-                exit(0);
-            }
+            _songTime += deltaTime / 1000.0;
+            _songProgress = _tempoMap.toBeats(_songTime);
 
-            std::fill(_noteStatuses.begin(), _noteStatuses.end(), 0);
-            for (size_t i = 0; i < _notes.size(); i++) {
-                Note note = _notes.at(i);
-                note.model->pos[1] = (3.18 + (note.startTime - _songProgress));
-                if (note.startTime - _songProgress <= 0.0 && note.endTime > 0.0) {
-                   //_noteStatuses[note.noteIndex] = 1;
-                }
+            //slide the window forward, only notes entering or leaving it are touched
+            while (_windowEnd < _noteCount && _noteTable[_windowEnd].startTime <= _songProgress + _lookAhead) {
+                _windowEnd++;
             }
+            while (_windowBegin < _windowEnd && _noteTable[_windowBegin].startTime < _songProgress - _maxDuration) {
+                _windowBegin++;
+            }
+
+            //press and release the keys whose notes the playhead crossed
+            _activeNotes.moveTo(_songProgress, _keyStates);
+        }
+
+        /*
+            Jump to an arbitrary point in the song, in beats, forwards or back. The window and the notes
+            sounding there are found with binary searches.
+        */
+        void seek(double songProgress) {
+            _songProgress = songProgress;
+            _songTime = _tempoMap.toSeconds(songProgress);
+
+            auto startsBefore = [](const Note& note, double time) {
+                return note.startTime < time;
+            };
+            auto startsAfter = [](double time, const Note& note) {
+                return time < note.startTime;
+            };
+            const Note* end = _noteTable + _noteCount;
+            _windowBegin = std::lower_bound(_noteTable, end, _songProgress - _maxDuration, startsBefore) - _noteTable;
+            _windowEnd = std::upper_bound(_noteTable, end, _songProgress + _lookAhead, startsAfter) - _noteTable;
+            _activeNotes.seek(_songProgress, _keyStates);
+        }
+
+        //true once the last note has rung out
+        bool isFinished() {
+            return _songProgress > _songLength;
+        }
+
+        size_t getNoteCount() {
+            return _noteCount;
+        }
+
+        //the notes sorted by start time, valid until more are loaded
+        const NoteRenderer::Note* getNotes() {
+            return _noteTable;
+        }
+
+        /*
+            Convert a point in the song from beats to seconds.
+        */
+        double toSeconds(double beats) {
+            return _tempoMap.toSeconds(beats);
+        }
+
+        //how far into the song it is, in seconds
+        double getTime() {
+            return _songTime;
         }
 
-        std::vector<int> getNoteStatuses() {
-            return _noteStatuses;
+        //what each key is doing, valid until the next `update()`
+        const KeyStates& getKeyStates() {
+            return _keyStates;
         }
 };
 
@@ -0,0 +1,50 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+/*
+    A fixed size queue between exactly one producer thread and one consumer thread, with no locks so
+    neither side ever waits on the other. `push()` fails when the queue is full and `pop()` when it's
+    empty, it's up to the caller what to do about it. `Capacity` has to be a power of two.
+*/
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity has to be a power of two");
+
+    private:
+        T _items[Capacity];
+
+        //both only ever count up and wrap with the mask, each is written by one side only and kept on
+        //its own cache line so the two threads don't fight over it
+        alignas(64) std::atomic<size_t> _head{0}; //the next item to pop, written by the consumer
+        alignas(64) std::atomic<size_t> _tail{0}; //where the next item is pushed, written by the producer
+
+    public:
+        /*
+            Add an item from the producer thread, returns false and drops it if the queue is full.
+        */
+        bool push(const T& item) {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _head.load(std::memory_order_acquire) == Capacity)
+                return false;
+            _items[tail & (Capacity - 1)] = item;
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /*
+            Take the oldest item on the consumer thread, returns false if there isn't one.
+        */
+        bool pop(T& item) {
+            size_t head = _head.load(std::memory_order_relaxed);
+            if (head == _tail.load(std::memory_order_acquire))
+                return false;
+            item = _items[head & (Capacity - 1)];
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+};
+
+#endif
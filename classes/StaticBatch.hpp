@@ -0,0 +1,157 @@
+#ifndef STATIC_BATCH_HPP
+#define STATIC_BATCH_HPP
+
+#include "./Model.hpp"
+#include "./RenderQueue.hpp"
+#include "./TextureAtlas.hpp"
+#include "./MeshCache.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/*
+    Merges models that never move relative to each other into one model per texture and lighting state,
+    so the static scene takes a handful of draws. Each added model stays a part of its merged model and
+    can still be nudged with `setPartOffset()`, which is how keys are pressed.
+*/
+class StaticBatch {
+    struct Source {
+        Model* model;
+        float pos[3];
+    };
+
+    struct Group {
+        int textureKey; //the texture handle, or -1 for everything in the atlas
+        bool isLit;
+        std::vector<Source> sources;
+        Model* mergedModel = nullptr;
+    };
+
+    struct PartHandle {
+        size_t group;
+        size_t part;
+    };
+
+    private:
+        std::vector<Group> _groups;
+        std::vector<PartHandle> _parts;
+
+    public:
+        ~StaticBatch() {
+            clear();
+        }
+
+        /*
+            Delete the merged models, needs the gl context.
+        */
+        void clear() {
+            for (size_t i = 0; i < _groups.size(); i++) {
+                delete _groups.at(i).mergedModel;
+            }
+            _groups.clear();
+            _parts.clear();
+        }
+
+        /*
+            Queue `model`, placed at `offset` plus its own position, to be merged by `build()`. The model
+            isn't owned or changed. Returns an id for `setPartOffset()`.
+        */
+        size_t add(Model* model, const float offset[3], bool isLit) {
+            unsigned int textureHandle = model->getTextureHandle();
+            int textureKey = TextureAtlas::contains(textureHandle) ? -1 : (int)textureHandle;
+
+            size_t group = 0;
+            while (group < _groups.size() && (_groups.at(group).textureKey != textureKey || _groups.at(group).isLit != isLit)) {
+                group++;
+            }
+            if (group == _groups.size()) {
+                _groups.push_back(Group());
+                _groups.back().textureKey = textureKey;
+                _groups.back().isLit = isLit;
+            }
+
+            Source source;
+            source.model = model;
+            for (int axis = 0; axis < 3; axis++) {
+                source.pos[axis] = offset[axis] + model->pos[axis];
+            }
+            _groups.at(group).sources.push_back(source);
+            _parts.push_back({group, _groups.at(group).sources.size() - 1});
+            return _parts.size() - 1;
+        }
+
+        /*
+            Bake every group into one model, with the positions and atlas coordinates of its sources
+            applied to their vertices. Doesn't need the gl context.
+        */
+        void build() {
+            for (size_t g = 0; g < _groups.size(); g++) {
+                Group& group = _groups.at(g);
+                std::vector<float> vertices;
+                std::vector<uint32_t> indices;
+                std::vector<size_t> firstVertices;
+
+                for (size_t s = 0; s < group.sources.size(); s++) {
+                    const Source& source = group.sources.at(s);
+                    const std::vector<float>& sourceVertices = source.model->getVertexData();
+                    const std::vector<uint32_t>& sourceIndices = source.model->getIndexData();
+                    const float* uvTransform = source.model->getUvTransform();
+
+                    uint32_t firstVertex = (uint32_t)(vertices.size() / 8);
+                    firstVertices.push_back(firstVertex);
+                    for (size_t i = 0; i < sourceVertices.size(); i += 8) {
+                        vertices.insert(vertices.end(), {
+                            sourceVertices[i] + source.pos[0],
+                            sourceVertices[i + 1] + source.pos[1],
+                            sourceVertices[i + 2] + source.pos[2],
+                            sourceVertices[i + 3] * uvTransform[0] + uvTransform[2],
+                            sourceVertices[i + 4] * uvTransform[1] + uvTransform[3],
+                            sourceVertices[i + 5],
+                            sourceVertices[i + 6],
+                            sourceVertices[i + 7]
+                        });
+                    }
+                    for (size_t i = 0; i < sourceIndices.size(); i++) {
+                        indices.push_back(sourceIndices[i] + firstVertex);
+                    }
+                }
+
+                float boundsMin[3], boundsMax[3];
+                MeshCache::computeBounds(vertices, 8, boundsMin, boundsMax);
+                size_t vertexCount = vertices.size() / 8;
+
+                delete group.mergedModel;
+                group.mergedModel = new Model();
+                group.mergedModel->setVertexData(std::move(vertices), std::move(indices));
+                group.mergedModel->setBounds(boundsMin, boundsMax);
+                group.mergedModel->setTextureHandle(group.sources.front().model->getTextureHandle(), true);
+                for (size_t s = 0; s < group.sources.size(); s++) {
+                    size_t end = s + 1 < firstVertices.size() ? firstVertices.at(s + 1) : vertexCount;
+                    group.mergedModel->addPart(firstVertices.at(s), end - firstVertices.at(s));
+                }
+            }
+        }
+
+        void upload() {
+            for (size_t i = 0; i < _groups.size(); i++) {
+                _groups.at(i).mergedModel->upload();
+            }
+        }
+
+        void submit(RenderQueue& queue) {
+            const float origin[3] = {0, 0, 0};
+            for (size_t i = 0; i < _groups.size(); i++) {
+                queue.submit(_groups.at(i).mergedModel, origin, _groups.at(i).isLit);
+            }
+        }
+
+        /*
+            Move the model added as `partId` to `offset` from where it was merged.
+        */
+        void setPartOffset(size_t partId, const float offset[3]) {
+            const PartHandle& handle = _parts.at(partId);
+            _groups.at(handle.group).mergedModel->setPartOffset(handle.part, offset);
+        }
+};
+
+#endif
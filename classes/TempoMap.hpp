@@ -0,0 +1,117 @@
+#ifndef TEMPO_MAP_HPP
+#define TEMPO_MAP_HPP
+
+#include <vector>
+#include <algorithm>
+
+/*
+    Converts between beats and seconds for a song whose tempo changes. The tempo is constant between
+    changes, so time is piecewise linear in beats, and each change keeps the seconds of everything
+    before it so either direction is a binary search and a multiply.
+*/
+class TempoMap {
+    public:
+        //a tempo that holds from `beat` to the next change, as it's kept in the song cache
+        struct TempoChange {
+            double beat;
+            double beatsPerMinute;
+        };
+
+    private:
+        struct Segment {
+            double beat;
+            double seconds; //when the segment starts, the sum of every segment before it
+            double secondsPerBeat;
+        };
+
+        std::vector<TempoChange> _changes;
+        std::vector<Segment> _segments;
+
+    public:
+        static constexpr double DEFAULT_BEATS_PER_MINUTE = 124.0;
+
+        TempoMap() {
+            build();
+        }
+
+        /*
+            Forget every tempo change, the song plays at the default tempo until more are added.
+        */
+        void clear() {
+            _changes.clear();
+            build();
+        }
+
+        /*
+            Change to `beatsPerMinute` at `beat`, takes effect once `build()` is called. Changes can be
+            added in any order, of two at the same beat the last one added wins.
+        */
+        void addChange(double beat, double beatsPerMinute) {
+            if (beatsPerMinute > 0.0) {
+                _changes.push_back({std::max(beat, 0.0), beatsPerMinute});
+            }
+        }
+
+        /*
+            Sort the changes and sum up the seconds before each one. The first tempo also holds before
+            its change, so the map always starts at beat 0. Without any changes the song plays at the
+            default tempo.
+        */
+        void build() {
+            std::stable_sort(_changes.begin(), _changes.end(), [](const TempoChange& a, const TempoChange& b) {
+                return a.beat < b.beat;
+            });
+
+            //keep only the last change at each beat, and drop the ones that don't change anything
+            std::vector<TempoChange> changes;
+            for (size_t i = 0; i < _changes.size(); i++) {
+                if (!changes.empty() && changes.back().beat == _changes[i].beat) {
+                    changes.pop_back();
+                }
+                if (changes.empty() || changes.back().beatsPerMinute != _changes[i].beatsPerMinute) {
+                    changes.push_back(_changes[i]);
+                }
+            }
+            _changes = changes;
+
+            _segments.clear();
+            if (_changes.empty()) {
+                _segments.push_back({0.0, 0.0, 60.0 / DEFAULT_BEATS_PER_MINUTE});
+                return;
+            }
+            _segments.reserve(_changes.size());
+            double seconds = 0.0;
+            for (size_t i = 0; i < _changes.size(); i++) {
+                double beat = i > 0 ? _changes[i].beat : 0.0;
+                if (i > 0) {
+                    seconds += (beat - _segments.back().beat) * _segments.back().secondsPerBeat;
+                }
+                _segments.push_back({beat, seconds, 60.0 / _changes[i].beatsPerMinute});
+            }
+        }
+
+        double toSeconds(double beat) const {
+            auto startsAfter = [](double beat, const Segment& segment) {
+                return beat < segment.beat;
+            };
+            std::vector<Segment>::const_iterator next = std::upper_bound(_segments.begin(), _segments.end(), beat, startsAfter);
+            const Segment& segment = next == _segments.begin() ? *next : *(next - 1);
+            return segment.seconds + (beat - segment.beat) * segment.secondsPerBeat;
+        }
+
+        double toBeats(double seconds) const {
+            auto startsAfter = [](double seconds, const Segment& segment) {
+                return seconds < segment.seconds;
+            };
+            std::vector<Segment>::const_iterator next = std::upper_bound(_segments.begin(), _segments.end(), seconds, startsAfter);
+            const Segment& segment = next == _segments.begin() ? *next : *(next - 1);
+            return segment.beat + (seconds - segment.seconds) / segment.secondsPerBeat;
+        }
+
+        //every change in order, empty if the song plays at the default tempo
+        const std::vector<TempoChange>& getChanges() const {
+            return _changes;
+        }
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef TEXTURE_ATLAS_HPP
+#define TEXTURE_ATLAS_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include "../helpers/openGlHelpers.cpp"
+#include "../helpers/globals.h"
+
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+
+/*
+    Packs the small textures into one so models using any of them can be drawn without rebinding. Every
+    packed texture has a fixed cell, models move their texture coordinates into it with
+    `getUvTransform()`, which is known before any of the images have loaded.
+*/
+class TextureAtlas {
+    private:
+        static const unsigned int _cellSize = 128; //smaller images are scaled up to fill their cell
+        static const unsigned int _gutter = 8; //each cell's edge pixels are repeated around it so mipmaps don't bleed
+        static const unsigned int _columns = 3;
+        static const unsigned int _size = _columns * (_cellSize + 2 * _gutter);
+        static const int _maxLevel = 3; //at 1/8 size the gutter is still a whole texel
+        static const int _cellCount = 8;
+
+        BmpImage _image;
+        std::atomic<int> _remainingCount;
+
+        /*
+            The cell for each packed texture, -1 for the ones that are too big to pack.
+        */
+        static int getCell(unsigned int textureHandle) {
+            switch (textureHandle) {
+                case gTextureHandles::TEST: return 0;
+                case gTextureHandles::WHITE_KEY: return 1;
+                case gTextureHandles::BLACK_KEY: return 2;
+                case gTextureHandles::LAMP_POST: return 3;
+                case gTextureHandles::LAMP_SHADE: return 4;
+                case gTextureHandles::LAMP_LIGHT: return 5;
+                case gTextureHandles::CEMENT: return 6;
+                case gTextureHandles::NOTE: return 7;
+                default: return -1;
+            }
+        }
+
+        static unsigned int getCellX(int cell) {
+            return (cell % _columns) * (_cellSize + 2 * _gutter);
+        }
+
+        static unsigned int getCellY(int cell) {
+            return (cell / _columns) * (_cellSize + 2 * _gutter);
+        }
+
+    public:
+        TextureAtlas() : _remainingCount(_cellCount) {
+            _image.width = _size;
+            _image.height = _size;
+            _image.format = GL_BGR;
+            _image.internalFormat = GL_RGB;
+            _image.storage.assign((size_t)_size * _size * 3, 0); //rows are a multiple of 4 bytes already
+            _image.pixels = _image.storage.data();
+        }
+
+        static bool contains(unsigned int textureHandle) {
+            return getCell(textureHandle) >= 0;
+        }
+
+        /*
+            Scale and offset that move 0 to 1 texture coordinates into the texture's cell, as
+            u * [0] + [2], v * [1] + [3]. Textures that aren't packed get the identity.
+        */
+        static void getUvTransform(unsigned int textureHandle, float transform[4]) {
+            int cell = getCell(textureHandle);
+            if (cell < 0) {
+                transform[0] = 1.0f;
+                transform[1] = 1.0f;
+                transform[2] = 0.0f;
+                transform[3] = 0.0f;
+                return;
+            }
+
+            transform[0] = (float)_cellSize / _size;
+            transform[1] = (float)_cellSize / _size;
+            transform[2] = (float)(getCellX(cell) + _gutter) / _size;
+            transform[3] = (float)(getCellY(cell) + _gutter) / _size;
+        }
+
+        /*
+            Copy a decoded image into its cell, safe to call from several threads at once for different
+            textures. Returns true for the last texture, when the atlas is ready for `createTexture()`.
+        */
+        bool add(unsigned int textureHandle, const BmpImage& image) {
+            int cell = getCell(textureHandle);
+            if (cell < 0)
+                return false;
+
+            unsigned int bytesPerPixel = image.format == GL_BGRA ? 4 : 3;
+            size_t sourceRowSize = ((size_t)image.width * bytesPerPixel + 3) & ~(size_t)3;
+            unsigned int cellX = getCellX(cell);
+            unsigned int cellY = getCellY(cell);
+
+            //nearest sample the image over the cell and its gutter, clamping at the image's edges
+            for (unsigned int y = 0; y < _cellSize + 2 * _gutter; y++) {
+                int insideY = std::min(std::max((int)y - (int)_gutter, 0), (int)_cellSize - 1);
+                const unsigned char* sourceRow = image.pixels + sourceRowSize * (insideY * image.height / _cellSize);
+                unsigned char* row = &_image.storage[((size_t)(cellY + y) * _size + cellX) * 3];
+                for (unsigned int x = 0; x < _cellSize + 2 * _gutter; x++) {
+                    int insideX = std::min(std::max((int)x - (int)_gutter, 0), (int)_cellSize - 1);
+                    std::memcpy(row + x * 3, sourceRow + (insideX * image.width / _cellSize) * bytesPerPixel, 3);
+                }
+            }
+
+            return --_remainingCount == 0;
+        }
+
+        /*
+            Upload the atlas into a new mipmapped texture.
+        */
+        unsigned int createTexture() {
+            unsigned int texture = ::createTexture(_image, "texture atlas");
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _maxLevel);
+            return texture;
+        }
+};
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef VIDEO_WRITER_HPP
+#define VIDEO_WRITER_HPP
+
+#include <GL/glew.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_opengl.h"
+
+#include "../helpers/globals.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <csignal>
+#endif
+
+/*
+    Streams every drawn frame to a file or to stdout. Frames are read back into a ring of pixel buffers
+    so the copy off the gpu overlaps the frames drawn after it, and they're converted and written on a
+    thread of their own. Files ending in .y4m, and "-" for stdout, get 4:2:0 yuv4mpeg, anything else
+    gets raw rgb24 frames top row first.
+*/
+class VideoWriter {
+    private:
+        static const size_t _ringSize = 3; //frames in flight on the gpu
+        static const size_t _queueSize = 8; //frames waiting on the writer before drawing has to wait
+
+        FILE* _file = nullptr;
+        bool _isY4m = true;
+        unsigned int _width = 0;
+        unsigned int _height = 0;
+
+        unsigned int _pixelBuffers[_ringSize] = {};
+        GLsync _fences[_ringSize] = {};
+        size_t _issuedCount = 0; //frames read into the ring
+        size_t _collectedCount = 0; //frames taken out of it and queued for the writer
+        size_t _writtenCount = 0;
+
+        std::thread _writer;
+        std::mutex _mutex;
+        std::condition_variable _frameQueued;
+        std::condition_variable _frameWritten;
+        std::deque<std::vector<unsigned char>> _queue; //rgba frames, bottom row first like gl
+        std::vector<std::vector<unsigned char>> _spareFrames; //written frames kept for reuse
+        bool _isStopping = false;
+        bool _hasFailed = false;
+
+        static inline FILE* _stdout = nullptr; //the real stdout once `reserveStdout()` has moved it
+
+        size_t getFrameSize() {
+            return (size_t)_width * _height * 4;
+        }
+
+        /*
+            Turn an rgba frame into the bytes that go in the file. Full range bt.601, with each chroma
+            sample the average of a 2x2 block. The header says so, players assume limited range otherwise.
+        */
+        void encode(const std::vector<unsigned char>& frame, std::vector<unsigned char>& output) {
+            const size_t rowSize = (size_t)_width * 4;
+            if (!_isY4m) {
+                output.resize((size_t)_width * _height * 3);
+                unsigned char* out = output.data();
+                for (unsigned int y = 0; y < _height; y++) {
+                    const unsigned char* row = &frame[rowSize * (_height - 1 - y)];
+                    for (unsigned int x = 0; x < _width; x++) {
+                        *out++ = row[x * 4];
+                        *out++ = row[x * 4 + 1];
+                        *out++ = row[x * 4 + 2];
+                    }
+                }
+                return;
+            }
+
+            const unsigned int chromaWidth = (_width + 1) / 2;
+            const unsigned int chromaHeight = (_height + 1) / 2;
+            const char* marker = "FRAME\n";
+            const size_t markerSize = std::strlen(marker);
+            output.resize(markerSize + (size_t)_width * _height + 2 * (size_t)chromaWidth * chromaHeight);
+            std::memcpy(output.data(), marker, markerSize);
+            unsigned char* luma = output.data() + markerSize;
+            unsigned char* blue = luma + (size_t)_width * _height;
+            unsigned char* red = blue + (size_t)chromaWidth * chromaHeight;
+
+            for (unsigned int y = 0; y < _height; y++) {
+                const unsigned char* row = &frame[rowSize * (_height - 1 - y)];
+                unsigned char* lumaRow = luma + (size_t)_width * y;
+                for (unsigned int x = 0; x < _width; x++) {
+                    const unsigned char* pixel = row + x * 4;
+                    lumaRow[x] = (unsigned char)((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+                }
+            }
+
+            for (unsigned int cy = 0; cy < chromaHeight; cy++) {
+                unsigned int y0 = cy * 2;
+                unsigned int y1 = std::min(y0 + 1, _height - 1);
+                const unsigned char* row0 = &frame[rowSize * (_height - 1 - y0)];
+                const unsigned char* row1 = &frame[rowSize * (_height - 1 - y1)];
+                for (unsigned int cx = 0; cx < chromaWidth; cx++) {
+                    unsigned int x0 = cx * 2 * 4;
+                    unsigned int x1 = std::min(cx * 2 + 1, _width - 1) * 4;
+                    int r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+                    int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+                    int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+                    //the sums are 4x the average, folded into the shift
+                    blue[(size_t)chromaWidth * cy + cx] = (unsigned char)(((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128);
+                    red[(size_t)chromaWidth * cy + cx] = (unsigned char)(((128 * r - 107 * g - 21 * b + 512) >> 10) + 128);
+                }
+            }
+        }
+
+        void runWriter() {
+            std::vector<unsigned char> output;
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true) {
+                _frameQueued.wait(lock, [this] { return _isStopping || !_queue.empty(); });
+                if (_queue.empty())
+                    return;
+
+                std::vector<unsigned char> frame = std::move(_queue.front());
+                _queue.pop_front();
+                bool hasFailed = _hasFailed; //once recording has stopped the rest are only given back
+                lock.unlock();
+
+                bool isWritten = false;
+                if (!hasFailed) {
+                    encode(frame, output);
+                    isWritten = std::fwrite(output.data(), 1, output.size(), _file) == output.size();
+                }
+
+                lock.lock();
+                if (isWritten) {
+                    _writtenCount++;
+                } else if (!_hasFailed) {
+                    _hasFailed = true;
+                    gShouldExit = true;
+                    std::cout << "Could not write video frame " << _writtenCount << "." << std::endl;
+                }
+                _spareFrames.push_back(std::move(frame));
+                _frameWritten.notify_one();
+            }
+        }
+
+        /*
+            Copy the oldest frame in the ring out of its pixel buffer and queue it for the writer, waiting
+            only if the gpu hasn't finished reading it back or the writer has fallen too far behind. A
+            frame that can't be read back stops the recording like a failed write, rather than putting
+            whatever was in the buffer into the video.
+        */
+        void collectFrame() {
+            size_t slot = _collectedCount % _ringSize;
+            if (_fences[slot] != nullptr) {
+                while (glClientWaitSync(_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+                glDeleteSync(_fences[slot]);
+                _fences[slot] = nullptr;
+            }
+
+            std::vector<unsigned char> frame;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _frameWritten.wait(lock, [this] { return _queue.size() < _queueSize; });
+                if (!_spareFrames.empty()) {
+                    frame = std::move(_spareFrames.back());
+                    _spareFrames.pop_back();
+                }
+            }
+            frame.resize(getFrameSize());
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffers[slot]);
+            const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, getFrameSize(), GL_MAP_READ_BIT);
+            bool isRead = pixels != nullptr;
+            if (isRead) {
+                std::memcpy(frame.data(), pixels, getFrameSize());
+                //the copy is garbage if the buffer's contents were lost while it was mapped
+                isRead = glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (isRead) {
+                    _queue.push_back(std::move(frame));
+                } else {
+                    _spareFrames.push_back(std::move(frame));
+                    if (!_hasFailed) {
+                        _hasFailed = true;
+                        gShouldExit = true;
+                        std::cout << "Could not read back video frame " << _collectedCount << "." << std::endl;
+                    }
+                }
+            }
+            _frameQueued.notify_one();
+            _collectedCount++;
+        }
+
+    public:
+        ~VideoWriter() {
+            close();
+        }
+
+        /*
+            Keep stdout for the video, anything printed from here on goes to stderr. Called as early as
+            possible so nothing printed before `open()` ends up in the stream either.
+        */
+        static void reserveStdout() {
+            if (_stdout != nullptr)
+                return;
+#ifndef _WIN32
+            std::fflush(stdout);
+            int videoDescriptor = dup(STDOUT_FILENO);
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+            _stdout = fdopen(videoDescriptor, "wb");
+#else
+            _stdout = stdout;
+#endif
+        }
+
+        bool isOpen() {
+            return _file != nullptr;
+        }
+
+        /*
+            Start a video of `width` by `height` frames, `framesPerSecond` only goes in the y4m header.
+            Needs the gl context, returns false if the file can't be opened or pixel buffers aren't
+            available.
+        */
+        bool open(const char* fileName, unsigned int width, unsigned int height, double framesPerSecond) {
+            if (!(GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range) || !GLEW_VERSION_2_1) {
+                std::cout << "Recording video needs pixel buffer objects." << std::endl;
+                return false;
+            }
+
+            std::string name = fileName;
+            if (name == "-") {
+                reserveStdout();
+                _file = _stdout;
+            } else {
+                _file = std::fopen(fileName, "wb");
+            }
+            if (_file == nullptr) {
+                std::cout << "Could not open " << fileName << " for writing." << std::endl;
+                return false;
+            }
+#ifndef _WIN32
+            //a reader closing the pipe shows up as a failed write rather than killing the program
+            std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+            _isY4m = name == "-" || (name.size() >= 4 && name.compare(name.size() - 4, 4, ".y4m") == 0);
+            _width = width;
+            _height = height;
+            if (_isY4m) {
+                //frame rates like 29.97 are written as a ratio over 1000
+                long rateNumerator = std::lround(framesPerSecond * 1000.0);
+                long rateDenominator = 1000;
+                while (rateNumerator % 10 == 0 && rateDenominator % 10 == 0) {
+                    rateNumerator /= 10;
+                    rateDenominator /= 10;
+                }
+                std::fprintf(_file, "YUV4MPEG2 W%u H%u F%ld:%ld Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width, height, rateNumerator, rateDenominator);
+            }
+
+            glGenBuffers(_ringSize, _pixelBuffers);
+            for (size_t i = 0; i < _ringSize; i++) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffers[i]);
+                glBufferData(GL_PIXEL_PACK_BUFFER, getFrameSize(), nullptr, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            _isStopping = false;
+            _hasFailed = false;
+            _issuedCount = 0;
+            _collectedCount = 0;
+            _writtenCount = 0;
+            _writer = std::thread(&VideoWriter::runWriter, this);
+            return true;
+        }
+
+        /*
+            Start reading back the frame that was just drawn, call it after drawing and before swapping.
+            The frame from `_ringSize` calls ago is handed to the writer.
+        */
+        void captureFrame() {
+            if (_issuedCount - _collectedCount == _ringSize) {
+                collectFrame();
+            }
+
+            size_t slot = _issuedCount % _ringSize;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffers[slot]);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            if (GLEW_VERSION_3_2 || GLEW_ARB_sync) {
+                _fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+            _issuedCount++;
+        }
+
+        /*
+            Write out the frames still in flight and close the file, needs the gl context.
+        */
+        void close() {
+            if (_file == nullptr)
+                return;
+
+            while (_collectedCount < _issuedCount) {
+                collectFrame();
+            }
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _isStopping = true;
+            }
+            _frameQueued.notify_one();
+            _writer.join();
+
+            glDeleteBuffers(_ringSize, _pixelBuffers);
+            for (size_t i = 0; i < _ringSize; i++) {
+                _pixelBuffers[i] = 0;
+            }
+            std::fflush(_file);
+            if (_file != _stdout) {
+                std::fclose(_file);
+            }
+            _file = nullptr;
+            _spareFrames.clear();
+            std::cout << "Wrote " << _writtenCount << " frames of video." << std::endl;
+        }
+
+        size_t getWrittenCount() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _writtenCount;
+        }
+};
+
+#endif
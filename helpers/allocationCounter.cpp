@@ -0,0 +1,52 @@
+#ifndef ALLOCATION_COUNTER_CPP
+#define ALLOCATION_COUNTER_CPP
+
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+//every call to operator new since the program started, from any thread
+static std::atomic<size_t> allocationCount(0);
+
+/*
+    How many times the heap has been allocated from so far. Take the difference around a stretch of
+    code to check that it doesn't allocate, the frame loop shouldn't once it's warmed up
+*/
+size_t getAllocationCount() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+//the global allocation functions are replaced to count, they otherwise behave like the default ones.
+//gcc sees the free() once they're inlined and mistakes it for a mismatch with new
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    operator delete(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    operator delete(memory);
+}
+
+#endif
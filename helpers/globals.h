@@ -4,12 +4,17 @@
 #include "SDL2/SDL.h"
 #include "../classes/Camera.hpp"
 
+#include <atomic>
+
+class ShaderLibrary;
+
 extern SDL_Window* gWindow;
 extern SDL_GLContext gCtx;
-extern bool gShouldExit;
+extern std::atomic<bool> gShouldExit; //set by loading threads as well as the main one
 extern const unsigned short gNumTextures;
 extern unsigned int gTextures[];
 extern Camera gCamera;
+extern ShaderLibrary gShaders;
 enum gTextureHandles {
 	TEST,
 	PIANO_SHELL,
@@ -0,0 +1,151 @@
+#ifndef HEADLESS_HELPERS_CPP
+#define HEADLESS_HELPERS_CPP
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "./globals.h"
+
+#include <iostream>
+
+//the offscreen context and the framebuffer everything is drawn into instead of a window
+struct HeadlessContext {
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+	unsigned int framebuffer = 0;
+	unsigned int colorBuffer = 0;
+	unsigned int depthBuffer = 0;
+	unsigned short width = 0;
+	unsigned short height = 0;
+};
+
+static HeadlessContext gHeadless;
+
+/*
+	Open the default device without a display server, through mesa's surfaceless platform when it's
+	there so machines without a gpu or X still get llvmpipe.
+*/
+static EGLDisplay openHeadlessDisplay() {
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay display = EGL_NO_DISPLAY;
+	if (getPlatformDisplay != nullptr) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	return display;
+}
+
+/*
+	Create an OpenGL context with no window and a `width` by `height` framebuffer to draw into, which is
+	left bound. The shaders run in a 3.3 core profile, the fixed function fallback needs a compatibility
+	one, which is also used if the driver can't make a core context. Sets gShouldExit and returns false
+	on failure.
+*/
+bool createHeadlessContext(unsigned short width, unsigned short height, bool isCoreProfile) {
+	gHeadless.display = openHeadlessDisplay();
+	EGLint major, minor;
+	if (gHeadless.display == EGL_NO_DISPLAY || !eglInitialize(gHeadless.display, &major, &minor)) {
+		std::cout << "Failed to open an EGL display." << std::endl;
+		gShouldExit = true;
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "EGL doesn't support desktop OpenGL." << std::endl;
+		gShouldExit = true;
+		return false;
+	}
+
+	//nothing is drawn to an egl surface, so any config will do and none is fine too
+	const EGLint configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(gHeadless.display, configAttributes, &config, 1, &configCount) || configCount < 1) {
+		config = EGL_NO_CONFIG_KHR;
+	}
+
+	//the same OpenGL 3.3 context the window asks for
+	EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, isCoreProfile ? EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT : EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+	gHeadless.context = eglCreateContext(gHeadless.display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (gHeadless.context == EGL_NO_CONTEXT && isCoreProfile) {
+		contextAttributes[5] = EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT;
+		gHeadless.context = eglCreateContext(gHeadless.display, config, EGL_NO_CONTEXT, contextAttributes);
+	}
+	if (gHeadless.context == EGL_NO_CONTEXT || !eglMakeCurrent(gHeadless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, gHeadless.context)) {
+		std::cout << "Failed to create an offscreen rendering context." << std::endl;
+		gShouldExit = true;
+		return false;
+	}
+
+	//initalize glew, which can't find a glx display here but loads the gl functions anyway
+	glewExperimental = GL_TRUE;
+	GLenum glewStatus = glewInit();
+	if (glewStatus != GLEW_OK && glewStatus != GLEW_ERROR_NO_GLX_DISPLAY) {
+		std::cout << "Could not initalize GLEW!" << std::endl;
+		exit(1);
+	}
+	glGetError(); //glew asks a core context for its extensions the old way, which is an error there
+	if (!(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object)) {
+		std::cout << "Offscreen rendering needs framebuffer objects." << std::endl;
+		gShouldExit = true;
+		return false;
+	}
+
+	//the framebuffer stands in for the window's, with the same 24 bit depth
+	gHeadless.width = width;
+	gHeadless.height = height;
+	glGenRenderbuffers(1, &gHeadless.colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, gHeadless.colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &gHeadless.depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, gHeadless.depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &gHeadless.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, gHeadless.framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, gHeadless.colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, gHeadless.depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Offscreen framebuffer is incomplete." << std::endl;
+		gShouldExit = true;
+		return false;
+	}
+	glViewport(0, 0, width, height);
+
+	//print some opengl config info
+	std::cout << "Vendor: " << glGetString(GL_VENDOR) << std::endl;
+	std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+	std::cout << "Version: " << glGetString(GL_VERSION) << std::endl;
+	return true;
+}
+
+/*
+	Free the framebuffer and the context.
+*/
+void cleanupHeadless() {
+	if (gHeadless.context != EGL_NO_CONTEXT) {
+		glDeleteTextures(gNumTextures, gTextures);
+		if (gHeadless.framebuffer != 0) {
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glDeleteFramebuffers(1, &gHeadless.framebuffer);
+			glDeleteRenderbuffers(1, &gHeadless.colorBuffer);
+			glDeleteRenderbuffers(1, &gHeadless.depthBuffer);
+		}
+		eglMakeCurrent(gHeadless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(gHeadless.display, gHeadless.context);
+	}
+	if (gHeadless.display != EGL_NO_DISPLAY) {
+		eglTerminate(gHeadless.display);
+	}
+	gHeadless = HeadlessContext();
+}
+
+#endif
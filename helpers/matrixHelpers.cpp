@@ -0,0 +1,84 @@
+#ifndef MATRIX_HELPERS_CPP
+#define MATRIX_HELPERS_CPP
+
+#include <cmath>
+
+//4x4 matrices are 16 floats in column major order, the layout gl and glsl expect
+
+void identityMatrix(float m[16]) {
+    for (int i = 0; i < 16; i++) {
+        m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
+}
+
+/*
+    `out` = `a` * `b`, `out` may be either of them
+*/
+void multiplyMatrices(const float a[16], const float b[16], float out[16]) {
+    float result[16];
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            result[column * 4 + row] = sum;
+        }
+    }
+    for (int i = 0; i < 16; i++) {
+        out[i] = result[i];
+    }
+}
+
+/*
+    The same projection as gluPerspective, `fieldOfView` is vertical and in degrees
+*/
+void perspectiveMatrix(float fieldOfView, float aspectRatio, float near, float far, float m[16]) {
+    float f = 1.0f / std::tan(fieldOfView * 0.5f * (float)M_PI / 180.0f);
+    identityMatrix(m);
+    m[0] = f / aspectRatio;
+    m[5] = f;
+    m[10] = (far + near) / (near - far);
+    m[11] = -1.0f;
+    m[14] = (2.0f * far * near) / (near - far);
+    m[15] = 0.0f;
+}
+
+/*
+    The same view transform as gluLookAt
+*/
+void lookAtMatrix(const float eye[3], const float center[3], const float up[3], float m[16]) {
+    float forward[3] = {center[0] - eye[0], center[1] - eye[1], center[2] - eye[2]};
+    float length = std::sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+    for (int i = 0; i < 3; i++) {
+        forward[i] /= length;
+    }
+
+    //side = forward x up, then up is recomputed so the three are perpendicular
+    float side[3] = {
+        forward[1] * up[2] - forward[2] * up[1],
+        forward[2] * up[0] - forward[0] * up[2],
+        forward[0] * up[1] - forward[1] * up[0]
+    };
+    length = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+    for (int i = 0; i < 3; i++) {
+        side[i] /= length;
+    }
+    float trueUp[3] = {
+        side[1] * forward[2] - side[2] * forward[1],
+        side[2] * forward[0] - side[0] * forward[2],
+        side[0] * forward[1] - side[1] * forward[0]
+    };
+
+    identityMatrix(m);
+    for (int i = 0; i < 3; i++) {
+        m[i * 4] = side[i];
+        m[i * 4 + 1] = trueUp[i];
+        m[i * 4 + 2] = -forward[i];
+    }
+    m[12] = -(side[0] * eye[0] + side[1] * eye[1] + side[2] * eye[2]);
+    m[13] = -(trueUp[0] * eye[0] + trueUp[1] * eye[1] + trueUp[2] * eye[2]);
+    m[14] = forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2];
+}
+
+#endif
@@ -3,6 +3,13 @@
 
 #include <vector>
 #include <string>
+#include <iostream>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+
+#include "./globals.h"
+#include "../classes/MappedFile.hpp"
 
 void drawAxes() {
     glBegin(GL_LINES);
@@ -20,48 +27,74 @@ void drawAxes() {
 }
 
 /*
-    Update the perspective projection to handle aspect ratio changes
+    Update the perspective projection to handle aspect ratio changes, the camera builds the matrix from
+    it each frame
 */
 void setProjection(float aspectRatio) {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+    gCamera.setAspectRatio(aspectRatio);
+}
 
-    gluPerspective(60, aspectRatio, 0.1, 100);
-    
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+/*
+    Whether the current context is a core profile, where nothing of the fixed function pipeline is left
+*/
+bool isCoreProfileContext() {
+    int profileMask = 0;
+    glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profileMask);
+    return (profileMask & GL_CONTEXT_CORE_PROFILE_BIT) != 0;
 }
 
-std::vector<std::string> split(std::string line, std::string delimiter) {
-   std::vector<std::string> result;
+/*
+    Compile a single shader stage, printing the info log and returning 0 on failure
+*/
+unsigned int compileShader(unsigned int type, const char* source) {
+   unsigned int shader = glCreateShader(type);
+   glShaderSource(shader, 1, &source, nullptr);
+   glCompileShader(shader);
 
-   size_t pos = 0;
-   std::string token;
-   while ((pos = line.find(delimiter)) != std::string::npos) {
-      token = line.substr(0, pos);
-      result.push_back(token);
-      line.erase(0, pos + delimiter.length());
+   int status;
+   glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+   if (!status) {
+      char log[1024];
+      glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+      std::cout << "Could not compile shader: " << log << std::endl;
+      glDeleteShader(shader);
+      return 0;
    }
-   result.push_back(line);
-
-   return result;
+   return shader;
 }
 
-template <typename T> int indexOf(std::vector<T> vec, T val) {
-   for (size_t i = 0; i < vec.size(); i++) {
-      if (vec.at(i) == val)
-         return (int)i;
+/*
+    Compile and link a vertex and fragment shader into a program, returns 0 on failure
+*/
+unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource) {
+   if (!GLEW_VERSION_2_0)
+      return 0;
+
+   unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+   unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+   if (vertexShader == 0 || fragmentShader == 0) {
+      glDeleteShader(vertexShader);
+      glDeleteShader(fragmentShader);
+      return 0;
    }
-   return -1;
-}
 
-void reverse(void* x, const int n) {
-   char* ch = (char*)x;
-   for (int k = 0; k < n / 2; k++) {
-      char tmp = ch[k];
-      ch[k] = ch[n - 1 - k];
-      ch[n - 1 - k] = tmp;
+   unsigned int program = glCreateProgram();
+   glAttachShader(program, vertexShader);
+   glAttachShader(program, fragmentShader);
+   glLinkProgram(program);
+   glDeleteShader(vertexShader);
+   glDeleteShader(fragmentShader);
+
+   int status;
+   glGetProgramiv(program, GL_LINK_STATUS, &status);
+   if (!status) {
+      char log[1024];
+      glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+      std::cout << "Could not link shader program: " << log << std::endl;
+      glDeleteProgram(program);
+      return 0;
    }
+   return program;
 }
 
 void fatal(const char* format, ...) {
@@ -72,75 +105,167 @@ void fatal(const char* format, ...) {
    exit(1);
 }
 
-unsigned int loadBmpFile(const char* file) {
-   //  Open file
-   FILE* f = fopen(file, "rb");
-   if (!f) fatal("Cannot open file %s\n", file);
-   //  Check image magic
-   unsigned short magic;
-   if (fread(&magic, 2, 1, f) != 1) fatal("Cannot read magic from %s\n", file);
-   if (magic != 0x4D42 && magic != 0x424D) fatal("Image magic not BMP in %s\n", file);
-   //  Read header
-   unsigned int dx, dy, off, k; // Image dimensions, offset and compression
-   unsigned short nbp, bpp;   // Planes and bits per pixel
-   if (fseek(f, 8, SEEK_CUR) || fread(&off, 4, 1, f) != 1 ||
-      fseek(f, 4, SEEK_CUR) || fread(&dx, 4, 1, f) != 1 || fread(&dy, 4, 1, f) != 1 ||
-      fread(&nbp, 2, 1, f) != 1 || fread(&bpp, 2, 1, f) != 1 || fread(&k, 4, 1, f) != 1)
-      fatal("Cannot read header from %s\n", file);
-   //  Reverse bytes on big endian hardware (detected by backwards magic)
-   if (magic == 0x424D) {
-      reverse(&off, 4);
-      reverse(&dx, 4);
-      reverse(&dy, 4);
-      reverse(&nbp, 2);
-      reverse(&bpp, 2);
-      reverse(&k, 4);
+/*
+   Print an error like `fatal()` but carry on, for code off the main thread that has to report back
+   instead of exiting under everything else. Always returns false
+*/
+bool printError(const char* format, ...) {
+   va_list args;
+   va_start(args, format);
+   vfprintf(stderr, format, args);
+   va_end(args);
+   return false;
+}
+
+/*
+   Bind a 2d texture, skipping the call when it's already bound. Every 2d bind goes through here so the
+   remembered texture stays right
+*/
+void bindTexture(unsigned int texture) {
+   static unsigned int boundTexture = 0;
+   if (texture != boundTexture) {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      boundTexture = texture;
+   }
+}
+
+/*
+   Pixels of a decoded image, rows bottom to top and padded to 4 bytes like gl's default unpack
+   alignment. They're kept in the file's byte order (bgr or bgra) and usually point straight into the
+   mapped file.
+*/
+struct BmpImage {
+   unsigned int width = 0;
+   unsigned int height = 0;
+   unsigned int format = GL_BGR; //GL_BGR or GL_BGRA
+   unsigned int internalFormat = GL_RGB; //GL_RGBA only when the file has a real alpha channel
+   const unsigned char* pixels = nullptr;
+   std::shared_ptr<MappedFile> file; //keeps `pixels` alive when they point into the file
+   std::vector<unsigned char> storage; //holds the pixels instead when the rows had to be flipped
+};
+
+static uint32_t readLittleEndian(const unsigned char* data, int byteCount) {
+   uint32_t value = 0;
+   for (int i = byteCount - 1; i >= 0; i--) {
+      value = (value << 8) | data[i];
    }
+   return value;
+}
+
+/*
+   Decode a 24 or 32 bit uncompressed bmp into `image`, doesn't need the gl context so it can run on
+   any thread. Returns false after printing why if the file can't be used
+*/
+bool readBmpFile(const char* file, BmpImage& image) {
+   //  Map the file and check the magic
+   std::shared_ptr<MappedFile> mapped = std::make_shared<MappedFile>(file);
+   if (!mapped->isOpen()) return printError("Cannot open file %s\n", file);
+   const unsigned char* data = (const unsigned char*)mapped->data();
+   size_t size = mapped->size();
+   if (size < 54) return printError("Cannot read header from %s\n", file);
+   if (data[0] != 'B' || data[1] != 'M') return printError("Image magic not BMP in %s\n", file);
+
+   //  Read the header, bmp fields are little endian on every platform
+   uint32_t off = readLittleEndian(data + 10, 4);
+   uint32_t headerSize = readLittleEndian(data + 14, 4);
+   int32_t dx = (int32_t)readLittleEndian(data + 18, 4);
+   int32_t dy = (int32_t)readLittleEndian(data + 22, 4); //negative when the rows are stored top to bottom
+   unsigned int nbp = readLittleEndian(data + 26, 2);
+   unsigned int bpp = readLittleEndian(data + 28, 2);
+   unsigned int k = readLittleEndian(data + 30, 4);
+   bool isTopDown = dy < 0;
+   dy = isTopDown ? -dy : dy;
+
    //  Check image parameters
-   unsigned int max;
-   glGetIntegerv(GL_MAX_TEXTURE_SIZE, (int*)&max);
-   if (dx<1 || dx>max) fatal("%s image width %d out of range 1-%d\n", file, dx, max);
-   if (dy<1 || dy>max) fatal("%s image height %d out of range 1-%d\n", file, dy, max);
-   if (nbp != 1)  fatal("%s bit planes is not 1: %d\n", file, nbp);
-   if (bpp != 24) fatal("%s bits per pixel is not 24: %d\n", file, bpp);
-   if (k != 0)    fatal("%s compressed files not supported\n", file);
+   if (headerSize < 40) return printError("%s uses an unsupported bmp header\n", file);
+   if (dx<1) return printError("%s image width %d out of range\n", file, dx);
+   if (dy<1) return printError("%s image height %d out of range\n", file, dy);
+   if (nbp != 1)  return printError("%s bit planes is not 1: %d\n", file, nbp);
+   if (bpp != 24 && bpp != 32) return printError("%s bits per pixel is not 24 or 32: %d\n", file, bpp);
+   image.format = bpp == 32 ? GL_BGRA : GL_BGR;
+   image.internalFormat = GL_RGB;
+
+   //  32 bit images may describe their channels with bit masks, only the usual bgra order is supported
+   if (k == 3 && bpp == 32) {
+      size_t masks = 14 + 40; //after a plain info header, inside the larger ones
+      if (size < masks + 16) return printError("Cannot read header from %s\n", file);
+      uint32_t red = readLittleEndian(data + masks, 4);
+      uint32_t green = readLittleEndian(data + masks + 4, 4);
+      uint32_t blue = readLittleEndian(data + masks + 8, 4);
+      uint32_t alpha = headerSize >= 56 ? readLittleEndian(data + masks + 12, 4) : 0;
+      if (red != 0x00FF0000 || green != 0x0000FF00 || blue != 0x000000FF || (alpha != 0 && alpha != 0xFF000000))
+         return printError("%s uses an unsupported channel layout\n", file);
+      if (alpha != 0) image.internalFormat = GL_RGBA;
+   } else if (k != 0) {
+      return printError("%s compressed files not supported\n", file);
+   }
 #ifndef GL_VERSION_2_0
    //  OpenGL 2.0 lifts the restriction that texture size must be a power of two
-   for (k = 1;k < dx;k *= 2);
-   if (k != dx) fatal("%s image width not a power of two: %d\n", file, dx);
-   for (k = 1;k < dy;k *= 2);
-   if (k != dy) fatal("%s image height not a power of two: %d\n", file, dy);
+   for (k = 1;k < (unsigned int)dx;k *= 2);
+   if (k != (unsigned int)dx) return printError("%s image width not a power of two: %d\n", file, dx);
+   for (k = 1;k < (unsigned int)dy;k *= 2);
+   if (k != (unsigned int)dy) return printError("%s image height not a power of two: %d\n", file, dy);
 #endif
 
-   //  Allocate image memory
-   unsigned int size = 3 * dx * dy;
-   unsigned char* image = (unsigned char*)malloc(size);
-   if (!image) fatal("Cannot allocate %d bytes of memory for image %s\n", size, file);
-   //  Seek to and read image
-   if (fseek(f, off, SEEK_SET) || fread(image, size, 1, f) != 1) fatal("Error reading data from image %s\n", file);
-   fclose(f);
-   //  Reverse colors (BGR -> RGB)
-   for (k = 0;k < size;k += 3) {
-      unsigned char temp = image[k];
-      image[k] = image[k + 2];
-      image[k + 2] = temp;
+   //  Rows are padded to a multiple of 4 bytes
+   size_t rowSize = ((size_t)dx * (bpp / 8) + 3) & ~(size_t)3;
+   if (off > size || (size - off) / rowSize < (size_t)dy) return printError("Error reading data from image %s\n", file);
+
+   image.width = dx;
+   image.height = dy;
+   if (isTopDown) {
+      //  Flip the rows into bottom to top order
+      image.storage.resize(rowSize * dy);
+      for (int32_t row = 0; row < dy; row++) {
+         std::memcpy(&image.storage[rowSize * (dy - 1 - row)], data + off + rowSize * row, rowSize);
+      }
+      image.pixels = image.storage.data();
+   } else {
+      //  Use the pixels where they are
+      image.pixels = data + off;
+      image.file = mapped;
    }
+   return true;
+}
+
+/*
+   Upload a decoded image into a new mipmapped texture with trilinear filtering, `file` is only used in
+   error messages
+*/
+unsigned int createTexture(const BmpImage& image, const char* file) {
+   //  Check the size against what the driver can handle
+   unsigned int max;
+   glGetIntegerv(GL_MAX_TEXTURE_SIZE, (int*)&max);
+   if (image.width>max) fatal("%s image width %d out of range 1-%d\n", file, image.width, max);
+   if (image.height>max) fatal("%s image height %d out of range 1-%d\n", file, image.height, max);
 
    //  Generate 2D texture
    unsigned int texture;
    glGenTextures(1, &texture);
-   glBindTexture(GL_TEXTURE_2D, texture);
-   //  Copy image
-   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, dx, dy, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-   if (glGetError()) fatal("Error in glTexImage2D %s %dx%d\n", file, dx, dy);
-   //  Scale linearly when image size doesn't match
+   bindTexture(texture);
+   //  Copy image, the driver swizzles bgr so it doesn't have to happen here
+   bool hasMipmaps = GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object || GLEW_VERSION_1_4;
+   if (!(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object) && GLEW_VERSION_1_4) {
+      glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+   }
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+   glTexImage2D(GL_TEXTURE_2D, 0, image.internalFormat, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE, image.pixels);
+   if (glGetError()) fatal("Error in glTexImage2D %s %dx%d\n", file, image.width, image.height);
+   if (GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object) {
+      glGenerateMipmap(GL_TEXTURE_2D);
+   }
+   //  Blend between the two nearest mipmap levels when minified, linearly when magnified
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, hasMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 
-   //  Free image memory
-   free(image);
    //  Return texture name
    return texture;
 }
 
-#endif
\ No newline at end of file
+unsigned int loadBmpFile(const char* file) {
+   BmpImage image;
+   if (!readBmpFile(file, image)) exit(1);
+   return createTexture(image, file);
+}
+
+#endif
@@ -20,9 +20,46 @@ void initSDL() {
 }
 
 /*
-	Create a window and OpenGL rendering context.
+	Create the OpenGL rendering context for the window and load the gl functions. Returns false if the
+	driver can't make a context with the requested profile.
 */
-void createWindow(const char* title, unsigned short width, unsigned short height) {
+bool createContext(bool isCoreProfile) {
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, isCoreProfile ? SDL_GL_CONTEXT_PROFILE_CORE : SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, isCoreProfile ? SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG : 0); //macOS only makes forward compatible core contexts
+	gCtx = SDL_GL_CreateContext(gWindow);
+	if (gCtx == nullptr)
+		return false;
+
+	//initalize glew
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		std::cout << "Could not initalize GLEW!" << std::endl;
+		exit(1);
+	}
+	glGetError(); //glew asks a core context for its extensions the old way, which is an error there
+	return true;
+}
+
+/*
+	Swap the window's context for a compatibility one, for the fixed function fallback when the shaders
+	can't run in a core profile.
+*/
+bool recreateCompatibilityContext() {
+	SDL_GL_DeleteContext(gCtx);
+	if (!createContext(false)) {
+		std::cout << "Failed to create rendering context: " << SDL_GetError() << std::endl;
+		gShouldExit = true;
+		return false;
+	}
+	return true;
+}
+
+/*
+	Create a window and OpenGL rendering context. The shaders run in a 3.3 core profile, the fixed
+	function fallback needs a compatibility one, which is also used if the driver can't make a core
+	context.
+*/
+void createWindow(const char* title, unsigned short width, unsigned short height, bool isCoreProfile) {
 	//use OpenGL version 3.3
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
@@ -50,22 +87,13 @@ void createWindow(const char* title, unsigned short width, unsigned short height
 		return;
 	}
 
-	//assign opengl context
-	gCtx = SDL_GL_CreateContext(gWindow);
-
-	//tell the program to exit gracefully if the rendering context couldn't be created
-	if (gCtx == nullptr) {
+	//assign opengl context, tell the program to exit gracefully if it couldn't be created
+	if (!createContext(isCoreProfile) && !(isCoreProfile && createContext(false))) {
 		std::cout << "Failed to create rendering context: " << SDL_GetError() << std::endl;
 		gShouldExit = true;
 		return;
 	}
 
-	//initalize glew
-	if (glewInit() != GLEW_OK) {
-		std::cout << "Could not initalize GLEW!" << std::endl;
-		exit(1);
-	}
-
 	//print some opengl config info
 	std::cout << "Vendor: " << glGetString(GL_VENDOR) << std::endl;
 	std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
@@ -11,6 +11,10 @@
 #include "./helpers/sdlHelpers.cpp"
 #include "./helpers/openGlHelpers.cpp"
 #include "./helpers/globals.h"
+#include "./helpers/allocationCounter.cpp"
+#ifdef HEADLESS
+#include "./helpers/headlessHelpers.cpp"
+#endif
 
 //classes
 #include "./classes/Model.hpp"
@@ -20,11 +24,27 @@
 #include "./classes/Lamp.hpp"
 #include "./classes/Ground.hpp"
 #include "./classes/Song.hpp"
+#include "./classes/AssetLoader.hpp"
+#include "./classes/TextureAtlas.hpp"
+#include "./classes/RenderQueue.hpp"
+#include "./classes/StaticBatch.hpp"
+#include "./classes/Shader.hpp"
+#include "./classes/ShaderLibrary.hpp"
+#include "./classes/VideoWriter.hpp"
+#include "./classes/Profiler.hpp"
+#include "./classes/MidiInput.hpp"
+#include "./classes/LiveNotes.hpp"
+#include "./classes/AudioPlayer.hpp"
 
 //c++ libraries
 #include <vector>
 #include <iostream>
 #include <string>
+#include <memory>
+#include <utility>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
 
 //
 // GLOBALS
@@ -32,62 +52,207 @@
 
 //memory space for ALL project globals should created here and used without declarations elsewhere
 SDL_Window* gWindow = nullptr;
-bool gShouldExit = false;
+std::atomic<bool> gShouldExit(false);
 SDL_GLContext gCtx = nullptr;
 const unsigned short gNumTextures = 12;
 unsigned int gTextures[gNumTextures];
 Camera gCamera(0, 7, 10);
+ShaderLibrary gShaders;
 
 //all file globals go here and should never be used elsewhere
 Song song;
 float lightPosition[4]  = {0.0f, 7.0f, 0.0f, 1.0f};
-Model* skyBox;
+float lightAmbient[4]   = {0.16f, 0.16f, 0.16f, 1.0f};
+float lightDiffuse[4]   = {0.9f, 0.9f, 0.9f, 1.0f};
+Model* skyBox = nullptr;
+RenderQueue renderQueue;
+StaticBatch staticBatch;
+VideoWriter videoWriter;
+Profiler profiler;
+MidiInput midiInput;
+LiveNotes liveNotes;
+AudioPlayer audioPlayer;
 
 //
 // UPDATE AND DRAW SCENE
 //
 
 /*
-	Create textures and models for objects in the scene, assign them references.
+	Queue the textures, models and song for the scene on `loader`. Files are decoded and models built
+	on its workers, the gl uploads and the hand off into `scene` happen on the main thread. The scene's
+	models are uploaded once they're merged, see `loadScene()`. Without a `songFile` the piano is played
+	live instead.
 */
-std::vector<Object*> buildScene() {
-	std::vector<Object*> scene;
+void buildScene(const char* songFile, AssetLoader& loader, std::vector<Object*>& scene) {
+	//the scene is filled in as objects finish, in a fixed order so drawing doesn't depend on timing
+	scene.assign(3, nullptr);
 
 	//load textures
-	gTextures[gTextureHandles::TEST] = loadBmpFile("./res/img/test.bmp");
-	gTextures[gTextureHandles::LAMP_POST] = loadBmpFile("./res/img/lampPost.bmp");
-	gTextures[gTextureHandles::LAMP_SHADE] = loadBmpFile("./res/img/lampShade.bmp");
-	gTextures[gTextureHandles::LAMP_LIGHT] = loadBmpFile("./res/img/lampLight.bmp");
-	gTextures[gTextureHandles::PIANO_SHELL] = loadBmpFile("./res/img/pianoShell.bmp");
-	gTextures[gTextureHandles::WHITE_KEY] = loadBmpFile("./res/img/whiteKey.bmp");
-	gTextures[gTextureHandles::BLACK_KEY] = loadBmpFile("./res/img/blackKey.bmp");
-	gTextures[gTextureHandles::SKYBOX_HOR] = loadBmpFile("./res/img/skyboxSideStars.bmp");
-	gTextures[gTextureHandles::FLOOR] = loadBmpFile("./res/img/floor.bmp");
-	gTextures[gTextureHandles::CEMENT] = loadBmpFile("./res/img/cementBrick.bmp");
-	gTextures[gTextureHandles::NOTE] = loadBmpFile("./res/img/note.bmp");
+	const std::vector<std::pair<gTextureHandles, const char*>> textureFiles = {
+		{gTextureHandles::TEST, "./res/img/test.bmp"},
+		{gTextureHandles::LAMP_POST, "./res/img/lampPost.bmp"},
+		{gTextureHandles::LAMP_SHADE, "./res/img/lampShade.bmp"},
+		{gTextureHandles::LAMP_LIGHT, "./res/img/lampLight.bmp"},
+		{gTextureHandles::PIANO_SHELL, "./res/img/pianoShell.bmp"},
+		{gTextureHandles::WHITE_KEY, "./res/img/whiteKey.bmp"},
+		{gTextureHandles::BLACK_KEY, "./res/img/blackKey.bmp"},
+		{gTextureHandles::SKYBOX_HOR, "./res/img/skyboxSideStars.bmp"},
+		{gTextureHandles::FLOOR, "./res/img/floor.bmp"},
+		{gTextureHandles::CEMENT, "./res/img/cementBrick.bmp"},
+		{gTextureHandles::NOTE, "./res/img/note.bmp"}
+	};
+	//the small ones are packed into an atlas, which is uploaded once the last of them is in
+	std::shared_ptr<TextureAtlas> atlas = std::make_shared<TextureAtlas>();
+	for (size_t i = 0; i < textureFiles.size(); i++) {
+		gTextureHandles handle = textureFiles.at(i).first;
+		const char* file = textureFiles.at(i).second;
+		loader.addJob([&loader, atlas, handle, file]() {
+			std::shared_ptr<BmpImage> image = std::make_shared<BmpImage>();
+			if (!readBmpFile(file, *image)) {
+				//exiting here would pull everything out from under the main thread, so it stops loading instead
+				loader.addUpload([]() {
+					gShouldExit = true;
+				});
+				return;
+			}
+
+			if (!TextureAtlas::contains(handle)) {
+				loader.addUpload([handle, file, image]() {
+					gTextures[handle] = createTexture(*image, file);
+				});
+			} else if (atlas->add(handle, *image)) {
+				loader.addUpload([atlas]() {
+					unsigned int texture = atlas->createTexture();
+					for (unsigned int handle = 0; handle < gNumTextures; handle++) {
+						if (TextureAtlas::contains(handle)) {
+							gTextures[handle] = texture;
+						}
+					}
+				});
+			}
+		});
+	}
 
 	//create the skybox
-	skyBox = ModelFactory::fromSkybox();
-	skyBox->setTextureHandle(gTextureHandles::SKYBOX_HOR);
-
-	//create the piano
-	Piano* piano = new Piano();
-	piano->pos[2] = 1.0f;
-	scene.push_back(piano);
+	loader.addJob([&loader]() {
+		Model* newSkyBox = ModelFactory::fromSkybox();
+		newSkyBox->setTextureHandle(gTextureHandles::SKYBOX_HOR);
+		loader.addUpload([newSkyBox]() {
+			newSkyBox->upload();
+			skyBox = newSkyBox;
+		});
+	});
+
+	//create the piano, then add the notes to the song now that the keys are laid out
+	loader.addJob([&loader, &scene, songFile]() {
+		Piano* piano = new Piano();
+		piano->pos[2] = 1.0f;
+		if (songFile != nullptr) {
+			loader.addJob([piano, songFile]() {
+				song.addNotesFromFile(songFile, piano);
+			});
+		}
+		loader.addUpload([piano, &scene, songFile]() {
+			if (songFile == nullptr) {
+				liveNotes.setPiano(piano);
+			}
+			scene.at(0) = piano;
+		});
+	});
 
 	//create the lamp
-	Lamp* lamp = new Lamp();
-	lamp->pos[0] = 6.5f;
-	lamp->pos[2] = 2.5f;
-	lightPosition[0] = lamp->pos[0];
-	lightPosition[2] = lamp->pos[2];
-	scene.push_back(lamp);
+	loader.addJob([&loader, &scene]() {
+		Lamp* lamp = new Lamp();
+		lamp->pos[0] = 6.5f;
+		lamp->pos[2] = 2.5f;
+		loader.addUpload([lamp, &scene]() {
+			lightPosition[0] = lamp->pos[0];
+			lightPosition[2] = lamp->pos[2];
+			scene.at(1) = lamp;
+		});
+	});
 
 	//create the ground
-	scene.push_back(new Ground());
+	loader.addJob([&loader, &scene]() {
+		Ground* ground = new Ground();
+		loader.addUpload([ground, &scene]() {
+			scene.at(2) = ground;
+		});
+	});
+}
+
+/*
+	Show how much of the scene has loaded as a bar across the middle of the screen.
+*/
+void drawLoadingScreen(size_t finishedCount, size_t taskCount) {
+	float progress = taskCount > 0 ? (float)finishedCount / taskCount : 0.0f;
+
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if (gShaders.isReady()) {
+		const float background[4] = {0.3f, 0.3f, 0.3f, 1.0f};
+		const float foreground[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+		glDisable(GL_DEPTH_TEST);
+		gShaders.drawRectangle(-0.5f, -0.02f, 0.5f, 0.02f, background);
+		gShaders.drawRectangle(-0.5f, -0.02f, -0.5f + progress, 0.02f, foreground);
+		glEnable(GL_DEPTH_TEST);
+		SDL_GL_SwapWindow(gWindow);
+		return;
+	}
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glColor3f(0.3f, 0.3f, 0.3f);
+	glRectf(-0.5f, -0.02f, 0.5f, 0.02f);
+	glColor3f(1.0f, 1.0f, 1.0f);
+	glRectf(-0.5f, -0.02f, -0.5f + progress, 0.02f);
+	glEnable(GL_DEPTH_TEST);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+
+	SDL_GL_SwapWindow(gWindow);
+}
+
+/*
+	Load the scene on worker threads, drawing the loading screen until everything is on the gpu.
+*/
+std::vector<Object*> loadScene(const char* songFile) {
+	std::vector<Object*> scene;
+	AssetLoader loader;
+	if (gWindow != nullptr) {
+		loader.setProgressCallback(drawLoadingScreen);
+	}
+	buildScene(songFile, loader, scene);
+
+	//keep handling events while loading so the window stays responsive and can be closed
+	while (!gShouldExit && !loader.processUploads(16)) {
+		if (gWindow != nullptr) {
+			double camDeltaTheta = 0;
+			double camDeltaY = 0;
+			processEvents(camDeltaTheta, camDeltaY);
+		}
+	}
 
-	//add the notes to the song
-	song.addNotesFromCsv("./res/song/skyReprise.csv", piano);
+	//nothing in the scene moves yet, so it's all merged into a few static models
+	if (!gShouldExit) {
+		for (size_t i = 0; i < scene.size(); i++) {
+			scene.at(i)->addStatic(staticBatch);
+		}
+		staticBatch.build();
+		staticBatch.upload();
+	}
 
 	return scene;
 }
@@ -95,113 +260,464 @@ std::vector<Object*> buildScene() {
 /*
 	Update the scene before it is drawn.
 */
-void update(std::vector<Object*> scene, double deltaTime) {
-	song.update(deltaTime);
+void update(const std::vector<Object*>& scene, double deltaTime) {
+	const KeyStates* keyStates = &song.getKeyStates();
+	if (midiInput.isOpen()) {
+		liveNotes.update(deltaTime, midiInput);
+		keyStates = &liveNotes.getKeyStates();
+	} else {
+		//with audio playing the song keeps to its clock
+		song.update(audioPlayer.followClock(deltaTime, song.getTime()));
+	}
 	for (size_t i = 0; i < scene.size(); i++) {
-		scene.at(i)->update(deltaTime, song.getNoteStatuses());
+		scene.at(i)->update(deltaTime, *keyStates);
 	}
 }
 
 /*
-	Draw the scene.
+	Draw the song's notes, or the ones being played live.
 */
-void draw(std::vector<Object*> scene) {
-	//clear screen
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void drawNotes() {
+	ProfileScope scope(profiler, "song");
+	if (midiInput.isOpen()) {
+		liveNotes.draw();
+	} else {
+		song.draw();
+	}
+}
 
+/*
+	Draw the scene with the fixed function pipeline, for drivers that can't run the shaders.
+*/
+void drawFixedFunction(const std::vector<Object*>& scene) {
 	//enable textures
-    glEnable(GL_TEXTURE_2D);
-    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glEnable(GL_TEXTURE_2D);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 	glColor3f(1.0f, 1.0f, 1.0f);
 
 	//reset transformations
+	float projection[16];
+	gCamera.getProjectionMatrix(projection);
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(projection);
+	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 	gCamera.setModelViewMatrix();
 
 	//draw the skybox
 	glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST);
-	skyBox->pos[0] = gCamera.getPosX();
-	skyBox->pos[1] = gCamera.getPosY();
-	skyBox->pos[2] = gCamera.getPosZ();
-	skyBox->draw();
+	glDisable(GL_DEPTH_TEST);
+	{
+		ProfileScope scope(profiler, "skybox");
+		skyBox->draw();
+	}
 	glEnable(GL_DEPTH_TEST);
 
 	//setup lighting
 	glEnable(GL_NORMALIZE);
 	glEnable(GL_LIGHTING);
 
-    float ambient[]   = {0.16f, 0.16f, 0.16f, 1.0f};
-    float diffuse[]   = {0.9f, 0.9f, 0.9f, 1.0f};
-    float specular[]  = {0.0f, 0.0f, 0.0f, 1.0f};
+	float specular[]  = {0.0f, 0.0f, 0.0f, 1.0f};
 
-	glLightfv(GL_LIGHT0,GL_AMBIENT, ambient);
-    glLightfv(GL_LIGHT0,GL_DIFFUSE, diffuse);
-    glLightfv(GL_LIGHT0,GL_SPECULAR, specular);
-    glLightfv(GL_LIGHT0,GL_POSITION, lightPosition);
-    glEnable(GL_LIGHT0);
+	glLightfv(GL_LIGHT0,GL_AMBIENT, lightAmbient);
+	glLightfv(GL_LIGHT0,GL_DIFFUSE, lightDiffuse);
+	glLightfv(GL_LIGHT0,GL_SPECULAR, specular);
+	glLightfv(GL_LIGHT0,GL_POSITION, lightPosition);
+	glEnable(GL_LIGHT0);
 
-	//draw the scene
-	for (size_t i = 0; i < scene.size(); i++) {
-		scene.at(i)->draw();
+	//draw the scene, models go through the queue sorted by state, then anything objects draw themselves
+	{
+		ProfileScope scope(profiler, "scene");
+		renderQueue.draw();
+		for (size_t i = 0; i < scene.size(); i++) {
+			scene.at(i)->draw();
+		}
 	}
 
 	//draw the song's notes
 	glDisable(GL_LIGHTING);
-	song.draw();
+	drawNotes();
+}
+
+/*
+	Draw the scene.
+*/
+void draw(const std::vector<Object*>& scene) {
+	//clear screen
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	//the skybox follows the camera
+	skyBox->pos[0] = gCamera.getPosX();
+	skyBox->pos[1] = gCamera.getPosY();
+	skyBox->pos[2] = gCamera.getPosZ();
+
+	renderQueue.clear();
+	staticBatch.submit(renderQueue);
+	for (size_t i = 0; i < scene.size(); i++) {
+		scene.at(i)->submit(renderQueue);
+	}
+
+	if (!gShaders.isReady()) {
+		drawFixedFunction(scene);
+		return;
+	}
+
+	//every program reads the camera and light from the shared uniform blocks
+	float view[16];
+	float projection[16];
+	gCamera.getViewMatrix(view);
+	gCamera.getProjectionMatrix(projection);
+	gShaders.setCamera(view, projection, skyBox->pos);
+	gShaders.setLight(lightPosition, lightAmbient, lightDiffuse);
+
+	//draw the skybox
+	Shader* sceneShader = gShaders.get("scene");
+	sceneShader->use();
+	sceneShader->setUniform("isLit", 0);
+	sceneShader->setUniform("isTextured", 1);
+	glDisable(GL_DEPTH_TEST);
+	{
+		ProfileScope scope(profiler, "skybox");
+		skyBox->draw();
+	}
+	glEnable(GL_DEPTH_TEST);
+
+	//draw the scene, models go through the queue sorted by state, then anything objects draw themselves
+	{
+		ProfileScope scope(profiler, "scene");
+		renderQueue.draw();
+		for (size_t i = 0; i < scene.size(); i++) {
+			scene.at(i)->draw();
+		}
+	}
+
+	//draw the song's notes
+	drawNotes();
+}
+
+//
+//	OPTIONS
+//
+
+//what was asked for on the command line
+struct Options {
+	const char* songFile = "./res/song/skyReprise.csv";
+	bool isHeadless = false;
+	long frameCount = -1; //frames to draw before exiting, -1 to run until the song ends
+	double framesPerSecond = 0.0; //when set, every frame advances time by exactly 1 / framesPerSecond
+	unsigned short width = 1024;
+	unsigned short height = 768;
+	const char* outputFile = nullptr; //where to record the frames, "-" for stdout
+	bool isProfiling = false;
+	const char* traceFile = nullptr; //where to write the profiler's chrome trace
+	const char* midiInputFile = nullptr; //where to read live midi from, "-" for stdin
+	const char* audioFile = nullptr; //a rendered track to play along with the song
+	bool isSynthesizing = false;
+};
+
+void printUsage(const char* program) {
+	std::cout << "Usage: " << program << " [options] [song.mid|song.csv|song.mvsong]" << std::endl
+		<< "  --headless      draw offscreen without a window or display, at 60 fps unless --fps is given" << std::endl
+		<< "  --frames N      exit after drawing N frames" << std::endl
+		<< "  --fps N         advance time by a fixed 1/N seconds per frame instead of by the clock" << std::endl
+		<< "  --size WxH      size of the window or offscreen framebuffer, 1024x768 by default" << std::endl
+		<< "  --output FILE   record every frame, as y4m for .y4m files and - (stdout) or raw rgb24 otherwise," << std::endl
+		<< "                  at 60 fps unless --fps is given" << std::endl
+		<< "  --profile       time each stage of the frame and print percentiles on exit" << std::endl
+		<< "  --trace FILE    profile and write every frame's timings to FILE as a Chrome trace" << std::endl
+		<< "  --midi-in FILE  play the piano live from raw midi in FILE instead of a song: an ALSA rawmidi" << std::endl
+		<< "                  device like /dev/snd/midiC1D0, a named pipe, or - (stdin)" << std::endl
+		<< "  --audio FILE    play FILE (wav, ogg, ...) as the song's audio and keep the notes in time with it" << std::endl
+		<< "  --synth         play the song's notes through a simple synthesizer, kept in time the same way" << std::endl
+		<< "                  (headless runs use SDL's dummy audio driver unless SDL_AUDIODRIVER says otherwise)" << std::endl;
+}
+
+/*
+	Read the command line into `options`, returns false if it can't be understood.
+*/
+bool parseOptions(int argc, char* argv[], Options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* argument = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		char* end = nullptr;
+
+		if (std::strcmp(argument, "--headless") == 0) {
+			options.isHeadless = true;
+		} else if (std::strcmp(argument, "--frames") == 0 && value != nullptr) {
+			options.frameCount = std::strtol(value, &end, 10);
+			if (*end != '\0' || options.frameCount < 0)
+				return false;
+			i++;
+		} else if (std::strcmp(argument, "--fps") == 0 && value != nullptr) {
+			options.framesPerSecond = std::strtod(value, &end);
+			if (*end != '\0' || !(options.framesPerSecond > 0.0))
+				return false;
+			i++;
+		} else if (std::strcmp(argument, "--size") == 0 && value != nullptr) {
+			long width = std::strtol(value, &end, 10);
+			if (*end != 'x')
+				return false;
+			long height = std::strtol(end + 1, &end, 10);
+			if (*end != '\0' || width < 1 || height < 1 || width > 16384 || height > 16384)
+				return false;
+			options.width = (unsigned short)width;
+			options.height = (unsigned short)height;
+			i++;
+		} else if (std::strcmp(argument, "--output") == 0 && value != nullptr) {
+			options.outputFile = value;
+			i++;
+		} else if (std::strcmp(argument, "--profile") == 0) {
+			options.isProfiling = true;
+		} else if (std::strcmp(argument, "--trace") == 0 && value != nullptr) {
+			options.isProfiling = true;
+			options.traceFile = value;
+			i++;
+		} else if (std::strcmp(argument, "--midi-in") == 0 && value != nullptr) {
+			options.midiInputFile = value;
+			i++;
+		} else if (std::strcmp(argument, "--audio") == 0 && value != nullptr) {
+			options.audioFile = value;
+			i++;
+		} else if (std::strcmp(argument, "--synth") == 0) {
+			options.isSynthesizing = true;
+		} else if (argument[0] != '-') {
+			options.songFile = argument;
+		} else {
+			return false;
+		}
+	}
+
+	if ((options.isHeadless || options.outputFile != nullptr) && options.framesPerSecond == 0.0) {
+		options.framesPerSecond = 60.0;
+	}
+	return true;
+}
+
+//
+//	AUDIO
+//
+
+/*
+	Open the audio device with the track, or the song's notes for the synthesizer. Without audio the song
+	still plays, just silently and by the frame clock.
+*/
+void loadAudio(const Options& options, Piano* piano) {
+	if (!audioPlayer.open())
+		return;
+
+	if (options.audioFile != nullptr) {
+		if (!audioPlayer.loadTrack(options.audioFile)) {
+			audioPlayer.close();
+		}
+		return;
+	}
+
+	std::vector<AudioPlayer::Tone> tones;
+	tones.reserve(song.getNoteCount());
+	const NoteRenderer::Note* notes = song.getNotes();
+	for (size_t i = 0; i < song.getNoteCount(); i++) {
+		AudioPlayer::Tone tone;
+		tone.startTime = song.toSeconds(notes[i].startTime);
+		tone.endTime = song.toSeconds(notes[i].startTime + notes[i].duration);
+		tone.frequency = 440.0f * (float)std::pow(2.0, (piano->getMidiNote(notes[i].keyIndex) - 69) / 12.0);
+		tone.amplitude = notes[i].velocity / 127.0f;
+		tones.push_back(tone);
+	}
+	audioPlayer.setTones(std::move(tones));
 }
 
 //
 //	ENTRYPOINT
 //
 int main(int argc, char* argv[]) {
-	//initalize sdl2, exit program if initalization fails
-	initSDL();
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (options.outputFile != nullptr && std::strcmp(options.outputFile, "-") == 0) {
+		VideoWriter::reserveStdout();
+	}
 
-	//try to create a window, gShouldExit is false if creation fails
-	createWindow("MidiVis [Sam Jansen, CSCI 4229]", 1024, 768);
-	setProjection(4.0f/3.0f);
+	if (options.isHeadless) {
+#ifdef HEADLESS
+		//render offscreen, gShouldExit is set if there's no context to be had
+		createHeadlessContext(options.width, options.height, true);
+#else
+		std::cout << "This build can't run headless." << std::endl;
+		return 1;
+#endif
+	} else {
+		//initalize sdl2, exit program if initalization fails
+		initSDL();
+
+		//try to create a window, gShouldExit is false if creation fails
+		createWindow("MidiVis [Sam Jansen, CSCI 4229]", options.width, options.height, true);
+	}
+	setProjection((float)options.width / options.height);
+	if (!gShouldExit) {
+		//the context is a core profile when the driver has one, which only the shaders can draw in
+		if (!gShaders.init() && isCoreProfileContext()) {
+			std::cout << "Switching to a compatibility profile for fixed function drawing." << std::endl;
+#ifdef HEADLESS
+			if (options.isHeadless) {
+				cleanupHeadless();
+				createHeadlessContext(options.width, options.height, false);
+			} else {
+				recreateCompatibilityContext();
+			}
+#else
+			recreateCompatibilityContext();
+#endif
+		}
+		std::cout << "Profile: " << (isCoreProfileContext() ? "core" : "compatibility") << std::endl;
+		if (options.isProfiling) {
+			profiler.enable(options.traceFile != nullptr);
+		}
+	}
 
 	//load the resouces neccecary to draw the scene
-	std::vector<Object*> scene = buildScene();
+	std::vector<Object*> scene = loadScene(options.midiInputFile != nullptr ? nullptr : options.songFile);
+
+	//start listening for live input once there's a piano to play
+	if (!gShouldExit && options.midiInputFile != nullptr) {
+		if (!midiInput.open(options.midiInputFile)) {
+			gShouldExit = true;
+		}
+	}
+
+	//open the audio, the piano is always the first object in the scene
+	bool hasAudio = options.audioFile != nullptr || options.isSynthesizing;
+	if (!gShouldExit && hasAudio && options.midiInputFile == nullptr) {
+		if (options.isHeadless) {
+			SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+		}
+		loadAudio(options, static_cast<Piano*>(scene.at(0)));
+	}
+
+	//start recording
+	if (!gShouldExit && options.outputFile != nullptr) {
+		if (!videoWriter.open(options.outputFile, options.width, options.height, options.framesPerSecond)) {
+			gShouldExit = true;
+		}
+	}
 
-	//setup deltaTime calculations
+	//setup deltaTime calculations, with a fixed timestep every run sees the same frames. Audio plays in
+	//real time, so with it the clock is used whatever the timestep
 	const double timerFrequency = SDL_GetPerformanceFrequency();
+	const double fixedDeltaTime = options.framesPerSecond > 0.0 && !audioPlayer.isOpen() ? 1000.0 / options.framesPerSecond : 0.0;
 	Uint64 timerNow = SDL_GetPerformanceCounter();
 	Uint64 timerLast = 0;
+	const Uint64 timerStart = timerNow;
 	double deltaTime = 0;
+	long frameCount = 0;
+	size_t warmAllocationCount = 0; //allocations made by the end of the first frame
+	audioPlayer.play();
 
 	//start program loop
-	while (!gShouldExit) {
+	while (!gShouldExit && frameCount != options.frameCount) {
+		profiler.beginFrame();
+
 		//calculate deltaTime
 		timerLast = timerNow;
 		timerNow = SDL_GetPerformanceCounter();
-		deltaTime = ((timerNow - timerLast)*1000 / timerFrequency);
+		deltaTime = fixedDeltaTime > 0.0 ? fixedDeltaTime : ((timerNow - timerLast)*1000 / timerFrequency);
+
+		if (!options.isHeadless) {
+			//process keyboard and window events
+			ProfileScope scope(profiler, "processEvents");
+			double camDeltaTheta = 0;
+			double camDeltaY = 0;
+			processEvents(camDeltaTheta, camDeltaY);
+
+			//move the camera based on the input
+			if (camDeltaTheta != 0 || camDeltaY != 0) {
+				gCamera.move(camDeltaTheta, camDeltaY, deltaTime);
+			}
+		}
 
-		//process keyboard and window events
-		double camDeltaTheta = 0;
-		double camDeltaY = 0;
-		processEvents(camDeltaTheta, camDeltaY);
+		{
+			ProfileScope scope(profiler, "update");
+			update(scene, deltaTime); //update the scene
+		}
+		{
+			ProfileScope scope(profiler, "draw");
+			draw(scene); //draw the scene
+		}
+		if (videoWriter.isOpen()) {
+			ProfileScope scope(profiler, "capture");
+			videoWriter.captureFrame();
+		}
+
+		if (!options.isHeadless) {
+			ProfileScope scope(profiler, "swap");
+			SDL_GL_SwapWindow(gWindow);
+		}
+		profiler.endFrame();
+		frameCount++;
+		if (frameCount == 1) {
+			warmAllocationCount = getAllocationCount();
+		}
 
-		//move the camera based on the input
-		if (camDeltaTheta != 0 || camDeltaY != 0) {
-			gCamera.move(camDeltaTheta, camDeltaY, deltaTime);
+		//stop once the last note has rung out, or live input has ended and its notes have floated away
+		if (midiInput.isOpen() ? liveNotes.isFinished() : song.isFinished()) {
+			gShouldExit = true;
 		}
+	}
 
-		update(scene, deltaTime); //update the scene
-		draw(scene); //draw the scene
+	size_t frameAllocationCount = frameCount > 1 ? getAllocationCount() - warmAllocationCount : 0;
 
-		SDL_GL_SwapWindow(gWindow);
+	//report how closely the notes kept to the audio
+	audioPlayer.printDrift(std::cout);
+	audioPlayer.close();
+
+	//report how quickly live input was picked up
+	if (midiInput.isOpen()) {
+		midiInput.close();
+		liveNotes.printLatency(std::cout);
+		if (midiInput.getDroppedCount() > 0) {
+			std::cout << "Dropped " << midiInput.getDroppedCount() << " midi events that came in too fast." << std::endl;
+		}
+	}
+
+	//report how long the frames took, headless runs are used for timing, including the video's last frames
+	videoWriter.close();
+	if (options.isHeadless && frameCount > 0) {
+		glFinish();
+		double seconds = (SDL_GetPerformanceCounter() - timerStart) / timerFrequency;
+		std::cout << "Drew " << frameCount << " frames in " << seconds << "s, "
+			<< (seconds * 1000.0 / frameCount) << "ms per frame, " << (frameCount / seconds) << " frames per second." << std::endl;
+	}
+
+	//report which stages the frames went to, and whether the frame path allocated once the first frame had
+	//set everything up. The profiler's own buffers and the driver count too
+	if (profiler.isEnabled()) {
+		profiler.finish();
+		profiler.printSummary(std::cout);
+		if (frameCount > 1) {
+			std::cout << frameAllocationCount << " allocations in the " << (frameCount - 1) << " frames after the first." << std::endl;
+		}
+		if (options.traceFile != nullptr) {
+			profiler.writeTrace(options.traceFile);
+		}
 	}
 
 	//cleanup scene objects
 	delete skyBox;
+	staticBatch.clear();
 	for (size_t i = 0; i < scene.size(); i++) {
 		delete scene.at(i);
 	}
+	gShaders.clear();
 
-	//cleanup window and SLD before exiting
+	//cleanup the context and SLD before exiting
+#ifdef HEADLESS
+	if (options.isHeadless) {
+		cleanupHeadless();
+		return 0;
+	}
+#endif
 	cleanup();
     return 0;
 }